@@ -3,11 +3,29 @@
 echo "Compiling Task 2..."
 
 # Compile with clang++ (macOS - no X11 needed)
-clang++ -std=c++11 -O2 \
+clang++ -std=c++11 -O2 -pthread \
     src/main.cpp \
+    src/Commands.cpp \
+    src/Batch.cpp \
+    src/Bench.cpp \
+    src/Pipeline.cpp \
+    src/Stream.cpp \
+    src/Serve.cpp \
+    src/BmpStream.cpp \
+    src/MappedBmp.cpp \
+    src/Interleaved.cpp \
     src/Histogram.cpp \
     src/LinearFilters.cpp \
+    src/Fft.cpp \
     src/NonLinearFilters.cpp \
+    src/NoiseFilters.cpp \
+    src/SimdKernels.cpp \
+    src/Border.cpp \
+    src/Parallel.cpp \
+    src/Profile.cpp \
+    src/Operations.cpp \
+    src/Geometric.cpp \
+    src/ImageProcessor.cpp \
     -I src \
     -o imageProcessor
 
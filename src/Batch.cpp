@@ -0,0 +1,205 @@
+#include "Batch.h"
+#include "Interleaved.h"
+#include "MappedBmp.h"
+#include "Parallel.h"
+#include "Profile.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <dirent.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <sys/stat.h>
+
+using namespace std;
+
+static bool is_directory(const string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static uint64_t file_size(const string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? (uint64_t)st.st_size : 0;
+}
+
+static bool has_bmp_extension(const string& name) {
+    if (name.size() < 4) return false;
+    string ext = name.substr(name.size() - 4);
+    transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext == ".bmp";
+}
+
+vector<string> list_batch_inputs(const string& path) {
+    vector<string> inputs;
+
+    if (is_directory(path)) {
+        DIR* dir = opendir(path.c_str());
+        if (!dir) throw runtime_error("Cannot open directory: " + path);
+        string prefix = path;
+        if (prefix.back() != '/') prefix += '/';
+        while (dirent* entry = readdir(dir)) {
+            string name = entry->d_name;
+            if (has_bmp_extension(name) && !is_directory(prefix + name)) {
+                inputs.push_back(prefix + name);
+            }
+        }
+        closedir(dir);
+        sort(inputs.begin(), inputs.end());
+        return inputs;
+    }
+
+    ifstream list(path.c_str());
+    if (!list) throw runtime_error("Cannot open batch list: " + path);
+    string line;
+    while (getline(list, line)) {
+        // Trim surrounding whitespace (including '\r' from CRLF files)
+        size_t b = line.find_first_not_of(" \t\r");
+        size_t e = line.find_last_not_of(" \t\r");
+        if (b != string::npos) inputs.push_back(line.substr(b, e - b + 1));
+    }
+    return inputs;
+}
+
+string expand_output_template(const string& pattern, const string& input, int index) {
+    size_t slash = input.find_last_of('/');
+    string name = slash == string::npos ? input : input.substr(slash + 1);
+    size_t dot = name.find_last_of('.');
+    if (dot != string::npos) name = name.substr(0, dot);
+
+    string out;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        if (pattern.compare(i, 6, "{name}") == 0) {
+            out += name;
+            i += 5;
+        } else if (pattern.compare(i, 7, "{index}") == 0) {
+            out += to_string(index);
+            i += 6;
+        } else {
+            out += pattern[i];
+        }
+    }
+    return out;
+}
+
+int run_batch(const CommandOptions& opts) {
+    vector<string> inputs = list_batch_inputs(opts.batchPath);
+    if (inputs.empty()) {
+        cerr << "Error: No images found in " << opts.batchPath << "\n";
+        return 1;
+    }
+
+    // Every output needs its own name
+    string pattern = opts.outputPath;
+    bool writesFile = command_writes_image(opts.command) || opts.command == "--histogram";
+    if (pattern.empty() && writesFile) pattern = "{name}_out.bmp";
+    if (!pattern.empty() && inputs.size() > 1 &&
+        pattern.find("{name}") == string::npos && pattern.find("{index}") == string::npos) {
+        cerr << "Error: -output= must contain {name} or {index} in batch mode\n";
+        return 1;
+    }
+
+    // Status lines are printed as images finish; reports are kept in input
+    // order and printed at the end
+    bool machineOutput = opts.command == "--characteristics" &&
+                         opts.format != FORMAT_TEXT && pattern.empty();
+    ostream& log = machineOutput ? cerr : cout;
+    vector<string> reports(inputs.size());
+    vector<bool> failed(inputs.size(), false);
+    uint64_t bytesRead = 0, pixels = 0;
+    mutex logMutex;
+
+    auto start = chrono::steady_clock::now();
+
+    parallel_for(inputs.size(), [&](int i) {
+        const string& input = inputs[i];
+        string output = pattern.empty() ? "" : expand_output_template(pattern, input, i);
+        ostringstream status, report;
+        try {
+            CommandOptions local = opts;
+            local.csvHeader = false;
+
+            // Mapped BMPs are decoded to planes only when the command
+            // has no interleaved or histogram-only path
+            MappedBmp bmp;
+            CImg<unsigned char> img, result;
+            bool mapped = bmp.open(input);
+            bool interleaved = mapped && interleaved_supports(opts, bmp);
+            if (interleaved) {
+                run_interleaved(local, bmp, output, status);
+            } else if (mapped && command_uses_histograms_only(opts)) {
+                ProfileScope scope(command_stage_name(opts.command));
+                run_histogram_command(local, bmp.histograms(), bmp.width(), bmp.height(),
+                                      input, output, report, status);
+                scope.counts(file_size(input), 0, (uint64_t)bmp.width() * bmp.height());
+            } else {
+                {
+                    ProfileScope scope("decode");
+                    if (mapped) bmp.to_planar(img);
+                    else img.load(input.c_str());
+                    scope.counts(file_size(input), img.size(), (uint64_t)img.width() * img.height());
+                }
+                ProfileScope scope(command_stage_name(opts.command));
+                run_command(local, img, input, output, result, report, status);
+                scope.counts(img.size(), result.size(), (uint64_t)img.width() * img.height());
+            }
+            if (command_writes_image(opts.command)) {
+                if (!interleaved) {
+                    ProfileScope scope("encode");
+                    result.save(output.c_str());
+                    scope.counts(result.size(), file_size(output),
+                                 (uint64_t)result.width() * result.height());
+                }
+                status << "Saved: " << output << "\n";
+            }
+
+            lock_guard<mutex> lock(logMutex);
+            bytesRead += file_size(input);
+            pixels += mapped ? (uint64_t)bmp.width() * bmp.height()
+                             : (uint64_t)img.width() * img.height();
+            reports[i] = report.str();
+            log << "[" << (i + 1) << "/" << inputs.size() << "] " << input << "\n"
+                << status.str();
+        } catch (const exception& e) {
+            lock_guard<mutex> lock(logMutex);
+            failed[i] = true;
+            cerr << "[" << (i + 1) << "/" << inputs.size() << "] " << input
+                 << ": Error: " << e.what() << "\n";
+        }
+    });
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    // CSV gets a single header; JSON reports are whole objects, so wrap
+    // them in one array
+    bool json = machineOutput && opts.format == FORMAT_JSON;
+    bool first = true;
+    if (machineOutput && opts.format == FORMAT_CSV) {
+        write_characteristics(cout, "", vector<RegionCharacteristics>(), FORMAT_CSV);
+    }
+    if (json) cout << "[\n";
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        if (reports[i].empty()) continue;
+        if (json && !first) cout << ",\n";
+        cout << reports[i];
+        first = false;
+    }
+    if (json) cout << "]\n";
+
+    // Rates count the processed images only; failures are listed apart
+    int failures = count(failed.begin(), failed.end(), true);
+    size_t processed = inputs.size() - failures;
+    double secs = max(seconds, 1e-9);
+    log << fixed << setprecision(2)
+        << "Batch: " << processed << "/" << inputs.size()
+        << " images in " << seconds << " s (" << thread_count() << " threads): "
+        << processed / secs << " img/s, "
+        << pixels / 1e6 / secs << " MPix/s, "
+        << bytesRead / 1e6 / secs << " MB/s read";
+    if (failures) log << ", " << failures << " failed";
+    log << "\n";
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,22 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "Commands.h"
+#include <string>
+#include <vector>
+
+// Images named by -batch=: every *.bmp in a directory (sorted), or the
+// non-empty lines of a list file
+std::vector<std::string> list_batch_inputs(const std::string& path);
+
+// Output name for one input: {name} becomes the input file name without
+// extension, {index} its position in the batch
+std::string expand_output_template(const std::string& pattern,
+                                   const std::string& input, int index);
+
+// Apply opts.command to every image of opts.batchPath, images spread over
+// the thread pool. Prints per-image status and aggregate throughput;
+// returns the process exit code.
+int run_batch(const CommandOptions& opts);
+
+#endif
@@ -0,0 +1,309 @@
+#include "Bench.h"
+#include "Batch.h"
+#include "LinearFilters.h"
+#include "MappedBmp.h"
+#include "NoiseFilters.h"
+#include "Parallel.h"
+#include "SimdKernels.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <dirent.h>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <sys/stat.h>
+
+using namespace std;
+
+// Repetitions per op/image: at least this many, and at least this long
+static const int BENCH_MIN_REPS = 5;
+static const int BENCH_MAX_REPS = 1000;
+static const double BENCH_MIN_SECONDS = 0.2;
+
+// Edge lengths of the synthetic square RGB images
+static const int BENCH_SYNTHETIC[] = { 1024, 4096 };
+
+namespace {
+
+struct BenchOp {
+    string name;
+    function<void(const CImg<unsigned char>&, CImg<unsigned char>&)> run;
+    bool writesImage;  // Counted as bytes written for GB/s
+};
+
+struct BenchResult {
+    string op, image;
+    int width, height, channels;
+    int reps;
+    double medianMs, p99Ms;
+    double mpixPerSec, gbPerSec;
+};
+
+}  // namespace
+
+static vector<BenchOp> bench_ops() {
+    vector<BenchOp> ops;
+    vector<vector<float>> gauss5(5, vector<float>(5));
+    const float binomial[5] = { 1, 4, 6, 4, 1 };
+    for (int i = 0; i < 5; ++i) {
+        for (int j = 0; j < 5; ++j) gauss5[i][j] = binomial[i] * binomial[j] / 256.0f;
+    }
+    vector<vector<float>> laplace3 = { { 0, -1, 0 }, { -1, 5, -1 }, { 0, -1, 0 } };
+    // Disc average: a large non-separable mask, which takes the FFT path
+    vector<vector<float>> disc15(15, vector<float>(15, 0.0f));
+    int discTaps = 0;
+    for (int i = 0; i < 15; ++i) {
+        for (int j = 0; j < 15; ++j) {
+            if ((i - 7) * (i - 7) + (j - 7) * (j - 7) <= 49) disc15[i][j] = 1, ++discTaps;
+        }
+    }
+    for (auto& r : disc15) {
+        for (float& v : r) v /= discTaps;
+    }
+
+    // Separable and non-separable masks take different paths
+    ops.push_back({ "convolve_gauss5", [gauss5](const CImg<unsigned char>& s, CImg<unsigned char>& d) {
+        convolve_universal(s, d, gauss5);
+    }, true });
+    ops.push_back({ "convolve_sharpen3", [laplace3](const CImg<unsigned char>& s, CImg<unsigned char>& d) {
+        convolve_universal(s, d, laplace3);
+    }, true });
+    ops.push_back({ "convolve_disc15", [disc15](const CImg<unsigned char>& s, CImg<unsigned char>& d) {
+        convolve_universal(s, d, disc15);
+    }, true });
+    ops.push_back({ "sedgesharp_v1", [](const CImg<unsigned char>& s, CImg<unsigned char>& d) {
+        edge_sharpen_type1(s, d);
+    }, true });
+    ops.push_back({ "sedgesharp_v2", [](const CImg<unsigned char>& s, CImg<unsigned char>& d) {
+        edge_sharpen_type2(s, d);
+    }, true });
+    ops.push_back({ "sedgesharp_v3", [](const CImg<unsigned char>& s, CImg<unsigned char>& d) {
+        edge_sharpen_type3(s, d);
+    }, true });
+    ops.push_back({ "sedgesharp_optimized", [](const CImg<unsigned char>& s, CImg<unsigned char>& d) {
+        edge_sharpen_optimized(s, d);
+    }, true });
+    for (int P = 1; P <= 16; P *= 2) {
+        ops.push_back({ "orosenfeld_P" + to_string(P), [P](const CImg<unsigned char>& s, CImg<unsigned char>& d) {
+            rosenfeld_operator(s, d, P);
+        }, true });
+    }
+    // Cost should not grow with the window
+    for (int k : { 3, 15, 61 }) {
+        ops.push_back({ "amean_k" + to_string(k), [k](const CImg<unsigned char>& s, CImg<unsigned char>& d) {
+            box_filter(s, d, k / 2, k / 2);
+        }, true });
+    }
+    ops.push_back({ "amean_k15_integral", [](const CImg<unsigned char>& s, CImg<unsigned char>& d) {
+        box_filter_integral(s, d, 7, 7);
+    }, true });
+    for (int sigma : { 2, 20 }) {
+        ops.push_back({ "gaussian_s" + to_string(sigma), [sigma](const CImg<unsigned char>& s, CImg<unsigned char>& d) {
+            gaussian_blur(s, d, sigma);
+        }, true });
+    }
+    for (int k : { 3, 15 }) {
+        ops.push_back({ "median_k" + to_string(k), [k](const CImg<unsigned char>& s, CImg<unsigned char>& d) {
+            median_filter(s, d, k / 2);
+        }, true });
+    }
+    ops.push_back({ "amedian_k3_s7", [](const CImg<unsigned char>& s, CImg<unsigned char>& d) {
+        adaptive_median(s, d, 3, 7);
+    }, true });
+    ops.push_back({ "hpower", [](const CImg<unsigned char>& s, CImg<unsigned char>& d) {
+        histogram_power23(s, d);
+    }, true });
+    ops.push_back({ "characteristics", [](const CImg<unsigned char>& s, CImg<unsigned char>&) {
+        for (int c = 0; c < s.spectrum(); ++c) compute_characteristics(s, c);
+    }, false });
+    return ops;
+}
+
+static bool is_directory(const string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+// BMPs of dir and of its direct subdirectories
+static vector<string> corpus_images(const string& dir) {
+    vector<string> images = list_batch_inputs(dir);
+    vector<string> subdirs;
+    DIR* d = opendir(dir.c_str());
+    if (!d) return images;
+    while (dirent* entry = readdir(d)) {
+        string name = entry->d_name;
+        string path = dir + (dir.back() == '/' ? "" : "/") + name;
+        if (name[0] != '.' && is_directory(path)) subdirs.push_back(path);
+    }
+    closedir(d);
+    sort(subdirs.begin(), subdirs.end());
+    for (const string& sub : subdirs) {
+        vector<string> more = list_batch_inputs(sub);
+        images.insert(images.end(), more.begin(), more.end());
+    }
+    return images;
+}
+
+// Deterministic noise, so runs on different machines see the same pixels
+static void synthetic_image(int size, CImg<unsigned char>& img) {
+    img.assign(size, size, 1, 3);
+    uint32_t state = 12345;
+    unsigned char* p = img.data();
+    for (size_t i = 0; i < img.size(); ++i) {
+        state = state * 1664525u + 1013904223u;
+        p[i] = (unsigned char)(state >> 24);
+    }
+}
+
+static BenchResult time_op(const BenchOp& op, const string& image,
+                           const CImg<unsigned char>& src, CImg<unsigned char>& dst) {
+    op.run(src, dst);  // Warm-up: page faults, pool start, dst allocation
+
+    vector<double> ms;
+    double total = 0;
+    while ((int)ms.size() < BENCH_MIN_REPS ||
+           (total < BENCH_MIN_SECONDS * 1000 && (int)ms.size() < BENCH_MAX_REPS)) {
+        auto start = chrono::steady_clock::now();
+        op.run(src, dst);
+        double t = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        ms.push_back(t);
+        total += t;
+    }
+    sort(ms.begin(), ms.end());
+
+    BenchResult r;
+    r.op = op.name;
+    r.image = image;
+    r.width = src.width();
+    r.height = src.height();
+    r.channels = src.spectrum();
+    r.reps = ms.size();
+    r.medianMs = ms[ms.size() / 2];
+    r.p99Ms = ms[min(ms.size() - 1, (size_t)(0.99 * ms.size()))];  // Nearest rank
+    double pixels = (double)r.width * r.height;
+    double bytes = pixels * r.channels * (op.writesImage ? 2 : 1);
+    double seconds = max(r.medianMs, 1e-6) / 1000;
+    r.mpixPerSec = pixels / 1e6 / seconds;
+    r.gbPerSec = bytes / 1e9 / seconds;
+    return r;
+}
+
+static void write_json(ostream& os, const vector<BenchResult>& results) {
+    os << "{\n\"threads\": " << thread_count() << ",\n\"simd\": \""
+       << simd_level_name(simd_level()) << "\",\n\"results\": [\n";
+    os << fixed;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        os << "{\"op\": \"" << r.op << "\", \"image\": \"" << r.image << "\", "
+           << "\"width\": " << r.width << ", \"height\": " << r.height << ", "
+           << "\"channels\": " << r.channels << ", \"reps\": " << r.reps << ", "
+           << setprecision(4) << "\"median_ms\": " << r.medianMs << ", \"p99_ms\": " << r.p99Ms
+           << ", " << setprecision(2) << "\"mpix_s\": " << r.mpixPerSec
+           << ", \"gb_s\": " << setprecision(3) << r.gbPerSec << "}"
+           << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    os << "]\n}\n";
+}
+
+// Value of "key" in one result line of write_json's output
+static string json_field(const string& line, const string& key) {
+    string tag = "\"" + key + "\": ";
+    size_t at = line.find(tag);
+    if (at == string::npos) return "";
+    at += tag.size();
+    if (line[at] == '"') {
+        size_t end = line.find('"', at + 1);
+        return line.substr(at + 1, end - at - 1);
+    }
+    size_t end = line.find_first_of(",}", at);
+    return line.substr(at, end - at);
+}
+
+// Baseline medians keyed by "op image"
+static map<string, double> read_baseline(const string& path) {
+    ifstream in(path.c_str());
+    if (!in) throw runtime_error("Cannot open baseline " + path);
+    map<string, double> medians;
+    string line;
+    while (getline(in, line)) {
+        string op = json_field(line, "op"), median = json_field(line, "median_ms");
+        if (op.empty() || median.empty()) continue;
+        medians[op + " " + json_field(line, "image")] = stod(median);
+    }
+    return medians;
+}
+
+int run_bench(const CommandOptions& opts) {
+    map<string, double> baseline;
+    if (!opts.baselinePath.empty()) baseline = read_baseline(opts.baselinePath);
+
+    vector<BenchOp> ops;
+    for (const BenchOp& op : bench_ops()) {
+        if (op.name.find(opts.benchFilter) != string::npos) ops.push_back(op);
+    }
+    if (ops.empty()) throw runtime_error("No benchmark matches -filter=" + opts.benchFilter);
+
+    string corpus = opts.inputPath.empty() ? "images" : opts.inputPath;
+    vector<string> images = corpus_images(corpus);
+    int synthetic = sizeof(BENCH_SYNTHETIC) / sizeof(BENCH_SYNTHETIC[0]);
+
+    cout << "Benchmark: " << ops.size() << " ops x " << images.size() + synthetic << " images, "
+         << thread_count() << " threads, " << simd_level_name(simd_level()) << "\n";
+    cout << left << setw(22) << "op" << setw(30) << "image" << right << setw(11) << "size"
+         << setw(11) << "median ms" << setw(10) << "p99 ms" << setw(10) << "MPix/s"
+         << setw(8) << "GB/s" << (baseline.empty() ? "" : "  vs baseline") << "\n";
+
+    vector<BenchResult> results;
+    int regressions = 0;
+    CImg<unsigned char> src, dst;
+    auto bench_image = [&](const string& image) {
+        for (const BenchOp& op : ops) {
+            BenchResult r = time_op(op, image, src, dst);
+            results.push_back(r);
+
+            ostringstream size;
+            size << r.width << "x" << r.height;
+            cout << left << setw(22) << r.op << setw(30) << r.image << right << setw(11)
+                 << size.str() << fixed << setprecision(3) << setw(11) << r.medianMs
+                 << setw(10) << r.p99Ms << setprecision(1) << setw(10) << r.mpixPerSec
+                 << setprecision(2) << setw(8) << r.gbPerSec;
+            auto base = baseline.find(r.op + " " + r.image);
+            if (base != baseline.end() && base->second > 0) {
+                double change = (r.medianMs / base->second - 1) * 100;
+                bool regressed = change > opts.tolerance;
+                regressions += regressed;
+                cout << "  " << showpos << setprecision(1) << change << noshowpos << "%"
+                     << (regressed ? "  REGRESSION" : "");
+            }
+            cout << "\n";
+        }
+    };
+
+    // Corpus images by path, then the synthetic sizes
+    for (const string& image : images) {
+        load_image(image, src);
+        bench_image(image);
+    }
+    for (int i = 0; i < synthetic; ++i) {
+        int size = BENCH_SYNTHETIC[i];
+        synthetic_image(size, src);
+        bench_image("synthetic_" + to_string(size) + "x" + to_string(size));
+    }
+
+    if (!opts.outputPath.empty()) {
+        ofstream out(opts.outputPath.c_str());
+        if (!out) throw runtime_error("Cannot write " + opts.outputPath);
+        write_json(out, results);
+        cout << "Results written to: " << opts.outputPath << "\n";
+    }
+    if (!baseline.empty()) {
+        cout << regressions << " regression(s) beyond " << opts.tolerance << "% against "
+             << opts.baselinePath << "\n";
+    }
+    return regressions ? 1 : 0;
+}
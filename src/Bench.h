@@ -0,0 +1,22 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "Commands.h"
+
+// --bench: time every filter over the BMPs of opts.inputPath (default
+// images/, and its direct subdirectories) and over synthetic
+// BENCH_SYNTHETIC sizes. Each op/image pair runs for at least
+// BENCH_MIN_REPS repetitions and BENCH_MIN_SECONDS after a warm-up run;
+// the table gives the median and p99 time, MPix/s and GB/s (planar bytes
+// read + written, per median run).
+//
+//   -output=PATH     also write the results as JSON, one result per line
+//   -baseline=PATH   compare medians with a JSON file written earlier
+//   -tolerance=PCT   slower than the baseline by more than PCT (default
+//                    10) counts as a regression
+//   -filter=TEXT     only ops whose name contains TEXT
+//
+// Returns 1 if any op regressed against the baseline, 0 otherwise.
+int run_bench(const CommandOptions& opts);
+
+#endif
@@ -0,0 +1,213 @@
+#include "BmpStream.h"
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+static uint32_t le32(const unsigned char* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put_le32(unsigned char* p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+// Row bytes without the padding to a multiple of 4
+static uint64_t packed_row_bytes(int width, int bpp) {
+    return ((uint64_t)width * bpp + 7) / 8;
+}
+
+// fseek with 64-bit offsets: gigapixel files pass 2 GB
+static void seek_to(FILE* file, uint64_t offset, const string& what) {
+    if (fseeko(file, (off_t)offset, SEEK_SET) != 0) {
+        throw runtime_error("Cannot seek in " + what);
+    }
+}
+
+void bmp24_header(unsigned char header[54], int width, int height) {
+    // The 32-bit size fields wrap for files over 4 GB; readers then size
+    // the image from its dimensions
+    uint64_t dataSize = (((uint64_t)3 * width + 3) & ~(uint64_t)3) * height;
+    memset(header, 0, 54);
+    header[0] = 'B';
+    header[1] = 'M';
+    put_le32(header + 0x02, (uint32_t)(54 + dataSize));
+    header[0x0A] = 54;
+    header[0x0E] = 40;
+    put_le32(header + 0x12, width);
+    put_le32(header + 0x16, height);
+    header[0x1A] = 1;
+    header[0x1C] = 24;
+    put_le32(header + 0x22, (uint32_t)dataSize);
+    header[0x27] = 1;
+    header[0x2B] = 1;
+}
+
+void bmp24_row(const CImg<unsigned char>& src, int y, unsigned char* dst) {
+    int w = src.width(), s = src.spectrum();
+    const unsigned char* r = src.data(0, y, 0, 0);
+    const unsigned char* g = s >= 2 ? src.data(0, y, 0, 1) : r;
+    const unsigned char* b = s >= 3 ? src.data(0, y, 0, 2) : r;
+    for (int x = 0; x < w; ++x, dst += 3) {
+        dst[0] = s == 2 ? 0 : b[x];  // Two channels save as (0, g, r), as in CImg
+        dst[1] = g[x];
+        dst[2] = r[x];
+    }
+}
+
+BmpReader::BmpReader(const string& path)
+    : file_(fopen(path.c_str(), "rb")), width_(0), height_(0), bpp_(0),
+      bottomUp_(true), dataOffset_(0), stride_(0) {
+    if (!file_) throw runtime_error("Cannot open " + path);
+
+    unsigned char header[54];
+    if (fread(header, 1, 54, file_) != 54 || header[0] != 'B' || header[1] != 'M') {
+        fclose(file_);
+        throw runtime_error("Not a BMP file: " + path);
+    }
+    dataOffset_ = le32(header + 0x0A);
+    uint32_t headerSize = le32(header + 0x0E);
+    int32_t dy = (int32_t)le32(header + 0x16);
+    uint32_t compression = le32(header + 0x1E);
+    uint32_t colors = le32(header + 0x2E);
+    width_ = (int32_t)le32(header + 0x12);
+    bpp_ = header[0x1C] | (header[0x1D] << 8);
+    bottomUp_ = dy > 0;
+    height_ = dy < 0 ? -dy : dy;
+
+    // BI_BITFIELDS only occurs with 16/32 bpp; like CImg, 32-bit pixels
+    // are read as BGRX whatever the masks say
+    string error;
+    if (width_ <= 0 || height_ <= 0) error = "Invalid BMP dimensions in ";
+    else if (bpp_ != 1 && bpp_ != 4 && bpp_ != 8 && bpp_ != 24 && bpp_ != 32) {
+        error = "Unsupported BMP bit depth " + to_string(bpp_) + " in ";
+    }
+    else if (compression != 0 && !(compression == 3 && bpp_ == 32)) {
+        error = "Compressed BMP cannot be streamed: ";
+    }
+    if (!error.empty()) {
+        fclose(file_);
+        throw runtime_error(error + path);
+    }
+    stride_ = (packed_row_bytes(width_, bpp_) + 3) & ~(uint64_t)3;
+
+    // The 32-bit size fields overflow past 4 GB, so check the real length
+    fseeko(file_, 0, SEEK_END);
+    uint64_t fileSize = (uint64_t)ftello(file_);
+    if (dataOffset_ + stride_ * height_ > fileSize) {
+        fclose(file_);
+        throw runtime_error("Truncated BMP file: " + path);
+    }
+
+    if (bpp_ <= 8) {
+        // Missing entries decode as black
+        uint32_t entries = 1u << bpp_;
+        if (colors == 0 || colors > entries) colors = entries;
+        palette_.assign(4 * entries, 0);
+        seek_to(file_, 14 + headerSize, path);
+        if (fread(palette_.data(), 4, colors, file_) != colors) {
+            fclose(file_);
+            throw runtime_error("Truncated BMP palette: " + path);
+        }
+    }
+}
+
+BmpReader::~BmpReader() {
+    fclose(file_);
+}
+
+void BmpReader::read_rows(int y, int count, CImg<unsigned char>& dst, int dstRow) {
+    if (count <= 0) return;
+    if (y < 0 || y + count > height_) throw runtime_error("BMP rows out of range");
+
+    // The strip is one contiguous run of file rows, stored last-row-first
+    // for bottom-up files
+    uint64_t first = bottomUp_ ? (uint64_t)(height_ - y - count) : (uint64_t)y;
+    rows_.resize(stride_ * count);
+    seek_to(file_, dataOffset_ + first * stride_, "BMP file");
+    if (fread(rows_.data(), 1, rows_.size(), file_) != rows_.size()) {
+        throw runtime_error("Short read from BMP file");
+    }
+
+    int w = width_;
+    for (int i = 0; i < count; ++i) {
+        const unsigned char* p = rows_.data() + stride_ * (bottomUp_ ? count - 1 - i : i);
+        unsigned char* r = dst.data(0, dstRow + i, 0, 0);
+        unsigned char* g = dst.data(0, dstRow + i, 0, 1);
+        unsigned char* b = dst.data(0, dstRow + i, 0, 2);
+
+        if (bpp_ == 24 || bpp_ == 32) {
+            int step = bpp_ / 8;
+            for (int x = 0; x < w; ++x, p += step) {
+                b[x] = p[0];
+                g[x] = p[1];
+                r[x] = p[2];
+            }
+            continue;
+        }
+
+        // Palette index of pixel x: 8/bpp pixels per byte, leftmost in
+        // the high bits
+        int perByte = 8 / bpp_, mask = (1 << bpp_) - 1;
+        for (int x = 0; x < w; ++x) {
+            int shift = 8 - bpp_ * (x % perByte + 1);
+            const unsigned char* col = &palette_[4 * ((p[x / perByte] >> shift) & mask)];
+            b[x] = col[0];
+            g[x] = col[1];
+            r[x] = col[2];
+        }
+    }
+}
+
+BmpWriter::BmpWriter(const string& path, int width, int height)
+    : file_(fopen(path.c_str(), "wb")), path_(path), width_(width), height_(height),
+      stride_(((uint64_t)3 * width + 3) & ~(uint64_t)3) {
+    if (!file_) throw runtime_error("Cannot create " + path);
+
+    uint64_t dataSize = stride_ * height;
+    unsigned char header[54];
+    bmp24_header(header, width, height);
+
+    // Writing the last byte sizes the file, so strips can land anywhere
+    unsigned char zero = 0;
+    if (fwrite(header, 1, 54, file_) != 54 ||
+        fseeko(file_, (off_t)(54 + dataSize - 1), SEEK_SET) != 0 ||
+        fwrite(&zero, 1, 1, file_) != 1) {
+        fclose(file_);
+        file_ = NULL;
+        throw runtime_error("Cannot write " + path);
+    }
+}
+
+BmpWriter::~BmpWriter() {
+    if (file_) fclose(file_);
+}
+
+void BmpWriter::write_rows(const CImg<unsigned char>& src, int srcRow, int count, int y) {
+    if (count <= 0) return;
+    if (!file_) throw runtime_error("BMP writer is closed");
+    if (y < 0 || y + count > height_ || src.width() != width_) {
+        throw runtime_error("BMP rows out of range");
+    }
+
+    rows_.assign(stride_ * count, 0);
+    for (int i = 0; i < count; ++i) {
+        // Bottom-up: the strip's last row comes first in the file
+        bmp24_row(src, srcRow + i, rows_.data() + stride_ * (count - 1 - i));
+    }
+
+    seek_to(file_, 54 + stride_ * (uint64_t)(height_ - y - count), path_);
+    if (fwrite(rows_.data(), 1, rows_.size(), file_) != rows_.size()) {
+        throw runtime_error("Cannot write " + path_);
+    }
+}
+
+void BmpWriter::close() {
+    if (!file_) return;
+    int failed = ferror(file_) | fclose(file_);
+    file_ = NULL;
+    if (failed) throw runtime_error("Cannot write " + path_);
+}
@@ -0,0 +1,76 @@
+#ifndef BMP_STREAM_H
+#define BMP_STREAM_H
+
+#include "Utils.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Row-strip access to uncompressed BMP files, for images too large to
+// decode whole. Rows are addressed top-down as in CImg and decoded into
+// the same planar 3-channel RGB layout CImg's loader produces, so strips
+// can go straight through the existing filters.
+
+// The 54-byte header CImg's save_bmp writes: 24 bpp, bottom-up, rows
+// padded to 4 bytes, pixel data right after the header
+void bmp24_header(unsigned char header[54], int width, int height);
+
+// Row y of src as 24-bit BMP pixels (B, G, R; no padding), with CImg's
+// mapping of 1 and 2-channel images
+void bmp24_row(const CImg<unsigned char>& src, int y, unsigned char* dst);
+
+class BmpReader {
+public:
+    // Opens the file and parses its headers (1, 4, 8, 24 or 32 bpp,
+    // bottom-up or top-down). Throws runtime_error otherwise.
+    explicit BmpReader(const std::string& path);
+    ~BmpReader();
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    uint64_t stride() const { return stride_; }  // File bytes per row
+
+    // Decode image rows [y, y + count) into rows [dstRow, dstRow + count)
+    // of dst, which must be width() wide with 3 channels
+    void read_rows(int y, int count, CImg<unsigned char>& dst, int dstRow);
+
+    BmpReader(const BmpReader&) = delete;
+    BmpReader& operator=(const BmpReader&) = delete;
+
+private:
+    std::FILE* file_;
+    int width_, height_, bpp_;
+    bool bottomUp_;
+    uint64_t dataOffset_, stride_;
+    std::vector<unsigned char> palette_;  // BGRA entries, 1 << bpp of them
+    std::vector<unsigned char> rows_;     // Raw bytes of the strip being read
+};
+
+// Writes a 24-bit bottom-up BMP (the format CImg saves) strip by strip,
+// rows given top-down. The file is sized up front, so strips can be
+// written in any order.
+class BmpWriter {
+public:
+    BmpWriter(const std::string& path, int width, int height);
+    ~BmpWriter();
+
+    // Store rows [srcRow, srcRow + count) of src as image rows
+    // [y, y + count). src has 1 channel (written as gray) or at least 3.
+    void write_rows(const CImg<unsigned char>& src, int srcRow, int count, int y);
+
+    // Flush and close; throws if the data could not be written
+    void close();
+
+    BmpWriter(const BmpWriter&) = delete;
+    BmpWriter& operator=(const BmpWriter&) = delete;
+
+private:
+    std::FILE* file_;
+    std::string path_;
+    int width_, height_;
+    uint64_t stride_;
+    std::vector<unsigned char> rows_;
+};
+
+#endif
@@ -0,0 +1,23 @@
+#include "Border.h"
+
+using namespace std;
+
+bool parse_border_mode(const string& name, BorderMode& mode) {
+    if (name == "clamp")         mode = BORDER_CLAMP;
+    else if (name == "mirror")   mode = BORDER_MIRROR;
+    else if (name == "wrap")     mode = BORDER_WRAP;
+    else if (name == "constant") mode = BORDER_CONSTANT;
+    else if (name == "copy")     mode = BORDER_COPY;
+    else return false;
+    return true;
+}
+
+const char* border_mode_name(BorderMode mode) {
+    switch (mode) {
+        case BORDER_MIRROR:   return "mirror";
+        case BORDER_WRAP:     return "wrap";
+        case BORDER_CONSTANT: return "constant";
+        case BORDER_COPY:     return "copy";
+        default:              return "clamp";
+    }
+}
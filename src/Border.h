@@ -0,0 +1,81 @@
+#ifndef BORDER_H
+#define BORDER_H
+
+#include <string>
+
+// Border handling shared by the neighbourhood filters. Filters run their
+// interior with unchecked pointer arithmetic and only route the frame of
+// width rx/ry through border_fetch().
+
+enum BorderMode {
+    BORDER_CLAMP,     // Repeat the edge pixel:          aaa|abcd|ddd
+    BORDER_MIRROR,    // Reflect about the edge pixel:   dcb|abcd|cba
+    BORDER_WRAP,      // Tile the image periodically:    bcd|abcd|abc
+    BORDER_CONSTANT,  // Fixed value outside the image:  vvv|abcd|vvv
+    BORDER_COPY       // Frame pixels keep their source value
+};
+
+struct Border {
+    BorderMode mode;
+    int value;  // Outside value for BORDER_CONSTANT
+
+    Border(BorderMode m = BORDER_CLAMP, int v = 0) : mode(m), value(v) {}
+};
+
+// Parse "clamp", "mirror", "wrap", "constant" or "copy"
+bool parse_border_mode(const std::string& name, BorderMode& mode);
+const char* border_mode_name(BorderMode mode);
+
+// Map coordinate i onto [0, n); returns -1 for BORDER_CONSTANT outside.
+// BORDER_COPY never reads outside and is treated like clamp here.
+inline int border_index(int i, int n, BorderMode mode) {
+    if (i >= 0 && i < n) return i;
+    switch (mode) {
+        case BORDER_CONSTANT:
+            return -1;
+        case BORDER_WRAP:
+            i %= n;
+            return i < 0 ? i + n : i;
+        case BORDER_MIRROR: {
+            if (n == 1) return 0;
+            int period = 2 * (n - 1);
+            i %= period;
+            if (i < 0) i += period;
+            return i < n ? i : period - i;
+        }
+        default:
+            return i < 0 ? 0 : n - 1;
+    }
+}
+
+// Read plane(x, y) of a w x h plane with row stride w
+inline int border_fetch(const unsigned char* plane, int w, int h,
+                        int x, int y, const Border& border) {
+    int bx = border_index(x, w, border.mode);
+    int by = border_index(y, h, border.mode);
+    if (bx < 0 || by < 0) return border.value;
+    return plane[(size_t)by * w + bx];
+}
+
+// Call fn(x, y) for every pixel of rows [y0, y1) closer than rx columns or
+// ry rows to the edge
+template <typename Fn>
+void for_each_frame_pixel(int w, int h, int rx, int ry, int y0, int y1, Fn fn) {
+    for (int y = y0; y < y1; ++y) {
+        if (y < ry || y >= h - ry) {
+            for (int x = 0; x < w; ++x) fn(x, y);
+            continue;
+        }
+        int left = rx < w ? rx : w;
+        int right = w - rx > left ? w - rx : left;
+        for (int x = 0; x < left; ++x) fn(x, y);
+        for (int x = right; x < w; ++x) fn(x, y);
+    }
+}
+
+template <typename Fn>
+void for_each_frame_pixel(int w, int h, int rx, int ry, Fn fn) {
+    for_each_frame_pixel(w, h, rx, ry, 0, h, fn);
+}
+
+#endif
@@ -0,0 +1,285 @@
+#include "Commands.h"
+#include "LinearFilters.h"
+#include "NoiseFilters.h"
+#include "Pipeline.h"
+#include "Parallel.h"
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+using namespace std;
+
+CommandOptions::CommandOptions()
+    : tolerance(10), channel(0), gmin(0), gmax(255), variant(1), P(1), kernelSize(3), smax(7), sigma(1),
+      optimized(false),
+      borderSet(false), direction(ROSENFELD_HORIZONTAL), format(FORMAT_TEXT),
+      csvHeader(true), fuse(true), stream(false), profile(false), interleaved(true), stripRows(0),
+      tileW(0), tileH(0), regionX(0), regionY(0), regionW(-1), regionH(-1) {}
+
+bool parse_option(const string& arg, CommandOptions& opts, string& error) {
+    try {
+        if (arg.find("-input=") == 0) {
+            opts.inputPath = arg.substr(7);
+        }
+        else if (arg.find("-output=") == 0) {
+            opts.outputPath = arg.substr(8);
+        }
+        else if (arg.find("-batch=") == 0) {
+            opts.batchPath = arg.substr(7);
+        }
+        else if (arg.find("-socket=") == 0) {
+            opts.socketPath = arg.substr(8);
+        }
+        else if (arg.find("-baseline=") == 0) {
+            opts.baselinePath = arg.substr(10);
+        }
+        else if (arg.find("-filter=") == 0) {
+            opts.benchFilter = arg.substr(8);
+        }
+        else if (arg.find("-tolerance=") == 0) {
+            opts.tolerance = stod(arg.substr(11));
+        }
+        else if (arg.find("-channel=") == 0) {
+            opts.channel = arg.substr(9) == "all" ? -1 : stoi(arg.substr(9));
+        }
+        else if (arg.find("-format=") == 0) {
+            string f = arg.substr(8);
+            if (f == "text") opts.format = FORMAT_TEXT;
+            else if (f == "csv") opts.format = FORMAT_CSV;
+            else if (f == "json") opts.format = FORMAT_JSON;
+            else {
+                error = "Unknown format: " + f;
+                return false;
+            }
+        }
+        else if (arg.find("-tile=") == 0) {
+            if (sscanf(arg.c_str() + 6, "%dx%d", &opts.tileW, &opts.tileH) != 2 ||
+                opts.tileW <= 0 || opts.tileH <= 0) {
+                error = "Expected -tile=WxH";
+                return false;
+            }
+        }
+        else if (arg.find("-region=") == 0) {
+            if (sscanf(arg.c_str() + 8, "%d,%d,%d,%d", &opts.regionX, &opts.regionY,
+                       &opts.regionW, &opts.regionH) != 4) {
+                error = "Expected -region=X,Y,W,H";
+                return false;
+            }
+        }
+        else if (arg.find("-gmin=") == 0) {
+            opts.gmin = stoi(arg.substr(6));
+        }
+        else if (arg.find("-gmax=") == 0) {
+            opts.gmax = stoi(arg.substr(6));
+        }
+        else if (arg.find("-variant=") == 0) {
+            opts.variant = stoi(arg.substr(9));
+        }
+        else if (arg.find("-P=") == 0) {
+            opts.P = stoi(arg.substr(3));
+        }
+        else if (arg.find("-kernel=") == 0) {
+            opts.kernelSize = stoi(arg.substr(8));
+        }
+        else if (arg.find("-smax=") == 0) {
+            opts.smax = stoi(arg.substr(6));
+        }
+        else if (arg.find("-sigma=") == 0) {
+            opts.sigma = stof(arg.substr(7));
+        }
+        else if (arg.find("-threads=") == 0) {
+            set_thread_count(stoi(arg.substr(9)));
+        }
+        else if (arg.find("-border=") == 0) {
+            if (!parse_border_mode(arg.substr(8), opts.border.mode)) {
+                error = "Unknown border mode: " + arg.substr(8);
+                return false;
+            }
+            opts.borderSet = true;
+        }
+        else if (arg.find("-bordervalue=") == 0) {
+            opts.border.value = stoi(arg.substr(13));
+            if (opts.border.value < 0 || opts.border.value > 255) {
+                error = "-bordervalue must be in [0, 255]";
+                return false;
+            }
+        }
+        else if (arg.find("-direction=") == 0) {
+            if (!parse_rosenfeld_direction(arg.substr(11), opts.direction)) {
+                error = "Unknown direction: " + arg.substr(11);
+                return false;
+            }
+        }
+        else if (arg == "-optimized") {
+            opts.optimized = true;
+        }
+        else if (arg == "-nofuse") {
+            opts.fuse = false;
+        }
+        else if (arg == "-planar") {
+            opts.interleaved = false;
+        }
+        else if (arg == "-profile" || arg.find("-profile=") == 0) {
+            opts.profile = true;
+            if (arg.size() > 8) opts.profilePath = arg.substr(9);
+        }
+        else if (arg == "-stream") {
+            opts.stream = true;
+        }
+        else if (arg.find("-striprows=") == 0) {
+            opts.stripRows = stoi(arg.substr(11));
+            if (opts.stripRows < 1) {
+                error = "-striprows must be at least 1";
+                return false;
+            }
+        }
+    } catch (const logic_error&) {
+        // stoi: invalid_argument / out_of_range
+        error = "Invalid number in " + arg;
+        return false;
+    }
+    return true;
+}
+
+string command_stage_name(const string& command) {
+    if (command.find("--pipeline=") == 0) return "pipeline";
+    return command.find("--") == 0 ? command.substr(2) : command;
+}
+
+bool command_writes_image(const string& command) {
+    if (command.find("--pipeline=") == 0) {
+        CommandOptions base;
+        for (const auto& stage : parse_pipeline(command.substr(11), base)) {
+            if (command_writes_image(stage.command)) return true;
+        }
+        return false;
+    }
+    return command == "--hpower" || command == "--sedgesharp" ||
+           command == "--orosenfeld" || command == "--amean" || command == "--gaussian" ||
+           command == "--median" || command == "--amedian";
+}
+
+void report_characteristics(const CommandOptions& opts, int channels,
+                            const string& inputPath, const string& outputPath,
+                            vector<RegionCharacteristics> results,
+                            ostream& report, ostream& log) {
+    if (opts.channel >= 0) {
+        if (opts.channel >= channels) throw runtime_error("Channel out of range");
+        vector<RegionCharacteristics> selected;
+        for (const auto& r : results) {
+            if (r.channel == opts.channel) selected.push_back(r);
+        }
+        results.swap(selected);
+    }
+
+    if (outputPath.empty()) {
+        write_characteristics(report, inputPath, results, opts.format, opts.csvHeader);
+    } else {
+        ofstream file(outputPath.c_str());
+        write_characteristics(file, inputPath, results, opts.format);
+        log << "Saved: " << outputPath << "\n";
+    }
+}
+
+bool command_uses_histograms_only(const CommandOptions& opts) {
+    if (opts.command == "--histogram") return true;
+    return opts.command == "--characteristics" && opts.tileW <= 0 &&
+           opts.regionX == 0 && opts.regionY == 0 && opts.regionW < 0 && opts.regionH < 0;
+}
+
+void run_histogram_command(const CommandOptions& opts, const vector<vector<uint64_t>>& hists,
+                           int width, int height, const string& inputPath,
+                           const string& outputPath, ostream& report, ostream& log) {
+    int channels = hists.size();
+    if (opts.command == "--histogram") {
+        if (outputPath.empty()) throw runtime_error("--histogram needs an output path");
+        if (opts.channel < 0 || opts.channel >= channels) throw runtime_error("Channel out of range");
+        save_histogram_image(hists[opts.channel], outputPath);
+        log << "Histogram saved to: " << outputPath << "\n";
+        return;
+    }
+    vector<RegionCharacteristics> results;
+    for (int c = 0; c < channels; ++c) {
+        RegionCharacteristics r = {0, 0, width, height, c, characteristics_from_histogram(hists[c])};
+        results.push_back(r);
+    }
+    report_characteristics(opts, channels, inputPath, outputPath, results, report, log);
+}
+
+void run_command(const CommandOptions& opts, const CImg<unsigned char>& img,
+                 const string& inputPath, const string& outputPath,
+                 CImg<unsigned char>& result, ostream& report, ostream& log) {
+    const string& command = opts.command;
+
+    if (command.find("--pipeline=") == 0) {
+        run_pipeline(opts, img, inputPath, outputPath, result, report, log);
+    }
+    else if (command == "--hpower") {
+        histogram_power23(img, result, opts.gmin, opts.gmax);
+        log << "Applied power 2/3 histogram equalization\n";
+    }
+    else if (command == "--histogram") {
+        if (outputPath.empty()) throw runtime_error("--histogram needs an output path");
+        auto hist = compute_histogram(img, opts.channel);
+        save_histogram_image(hist, outputPath);
+        log << "Histogram saved to: " << outputPath << "\n";
+    }
+    else if (command == "--characteristics") {
+        int regionW = opts.regionW < 0 ? img.width() : opts.regionW;
+        int regionH = opts.regionH < 0 ? img.height() : opts.regionH;
+        auto results = compute_region_characteristics(img, opts.regionX, opts.regionY,
+                                                      regionW, regionH,
+                                                      opts.tileW, opts.tileH);
+        report_characteristics(opts, img.spectrum(), inputPath, outputPath, results,
+                               report, log);
+    }
+    else if (command == "--sedgesharp") {
+        if (opts.optimized) {
+            edge_sharpen_optimized(img, result, opts.borderSet ? opts.border : Border(BORDER_CLAMP));
+            log << "Applied optimized edge sharpening\n";
+        } else {
+            Border b = opts.borderSet ? opts.border : Border(BORDER_COPY);
+            if (opts.variant == 1) edge_sharpen_type1(img, result, b);
+            else if (opts.variant == 2) edge_sharpen_type2(img, result, b);
+            else if (opts.variant == 3) edge_sharpen_type3(img, result, b);
+            else throw runtime_error("Variant must be 1, 2 or 3");
+            log << "Applied edge sharpening (variant " << opts.variant << ")\n";
+        }
+    }
+    else if (command == "--orosenfeld") {
+        rosenfeld_operator(img, result, opts.P,
+                           opts.borderSet ? opts.border : Border(BORDER_CLAMP),
+                           opts.direction);
+        log << "Applied Rosenfeld operator (P=" << opts.P << ")\n";
+    }
+    else if (command == "--amean") {
+        if (opts.kernelSize < 3 || opts.kernelSize % 2 == 0) {
+            throw runtime_error("Kernel size must be odd and >= 3");
+        }
+        int r = opts.kernelSize / 2;
+        box_filter(img, result, r, r, opts.borderSet ? opts.border : Border(BORDER_CLAMP));
+        log << "Applied arithmetic mean (kernel=" << opts.kernelSize << ")\n";
+    }
+    else if (command == "--gaussian") {
+        gaussian_blur(img, result, opts.sigma,
+                      opts.borderSet ? opts.border : Border(BORDER_CLAMP));
+        log << "Applied Gaussian blur (sigma=" << opts.sigma << ")\n";
+    }
+    else if (command == "--median") {
+        if (opts.kernelSize < 3 || opts.kernelSize % 2 == 0) {
+            throw runtime_error("Kernel size must be odd and >= 3");
+        }
+        median_filter(img, result, opts.kernelSize / 2,
+                      opts.borderSet ? opts.border : Border(BORDER_CLAMP));
+        log << "Applied median (kernel=" << opts.kernelSize << ")\n";
+    }
+    else if (command == "--amedian") {
+        adaptive_median(img, result, opts.kernelSize, opts.smax,
+                        opts.borderSet ? opts.border : Border(BORDER_CLAMP));
+        log << "Applied adaptive median (kernel=" << opts.kernelSize
+            << ", smax=" << opts.smax << ")\n";
+    }
+    else {
+        throw runtime_error("Unknown command: " + command);
+    }
+}
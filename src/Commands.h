@@ -0,0 +1,82 @@
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include "Histogram.h"
+#include "NonLinearFilters.h"
+#include <ostream>
+#include <string>
+
+// Everything the command line selects; shared by single-image and batch runs
+struct CommandOptions {
+    std::string command;      // "--hpower", "--sedgesharp", ...
+    std::string inputPath;
+    std::string outputPath;   // Output file, or name template in batch mode
+    std::string batchPath;    // Directory or list file for -batch=
+    std::string socketPath;   // Unix socket for --serve
+    std::string baselinePath; // --bench results to compare against
+    std::string benchFilter;  // --bench: only ops containing this
+    std::string profilePath;  // -profile=: Chrome trace output
+    double tolerance;         // --bench: allowed slowdown in percent
+    int channel;              // -1 = all channels (--characteristics)
+    int gmin, gmax;
+    int variant, P;
+    int kernelSize;           // --amean/--median/--amedian window edge (odd)
+    int smax;                 // --amedian largest window edge (odd)
+    float sigma;              // --gaussian
+    bool optimized;
+    Border border;
+    bool borderSet;           // Otherwise each filter uses its own default
+    RosenfeldDirection direction;
+    CharacteristicsFormat format;
+    bool csvHeader;           // Cleared by batch mode after the first image
+    bool fuse;                // Tile-fuse neighbourhood filters in pipelines
+    bool stream;              // Process the BMP in row strips (-stream)
+    bool profile;             // Time each stage (-profile)
+    bool interleaved;         // Colour BMPs may skip the planar copy (-planar clears)
+    int stripRows;            // Rows per strip; 0 = from a memory budget
+    int tileW, tileH;
+    int regionX, regionY, regionW, regionH;  // W/H < 0 = whole image
+
+    CommandOptions();
+};
+
+// Parse one "-name=value" option into opts. Unknown options are ignored;
+// returns false with a message if the value is malformed.
+bool parse_option(const std::string& arg, CommandOptions& opts, std::string& error);
+
+// Name of the command in -profile output: "--sedgesharp" -> "sedgesharp",
+// "--pipeline=..." -> "pipeline"
+std::string command_stage_name(const std::string& command);
+
+// True if the command produces an image to save
+bool command_writes_image(const std::string& command);
+
+// Write --characteristics results, keeping only opts.channel unless it is
+// -1; to outputPath, or to report if that is empty
+void report_characteristics(const CommandOptions& opts, int channels,
+                            const std::string& inputPath, const std::string& outputPath,
+                            std::vector<RegionCharacteristics> results,
+                            std::ostream& report, std::ostream& log);
+
+// True for commands answered from whole-image channel histograms alone:
+// --histogram, and --characteristics without -tile/-region
+bool command_uses_histograms_only(const CommandOptions& opts);
+
+// Finish such a command from the R, G, B histograms of a width x height
+// image (counted by a streaming or mapped reader instead of from a CImg)
+void run_histogram_command(const CommandOptions& opts,
+                           const std::vector<std::vector<uint64_t>>& hists,
+                           int width, int height, const std::string& inputPath,
+                           const std::string& outputPath, std::ostream& report,
+                           std::ostream& log);
+
+// Run opts.command on img. Image commands fill result; --histogram saves
+// its plot to outputPath; --characteristics writes to outputPath, or to
+// report if that is empty. Progress lines go to log.
+// Throws on unknown commands and invalid parameters.
+void run_command(const CommandOptions& opts, const CImg<unsigned char>& img,
+                 const std::string& inputPath, const std::string& outputPath,
+                 CImg<unsigned char>& result, std::ostream& report,
+                 std::ostream& log);
+
+#endif
@@ -0,0 +1,211 @@
+#ifndef CONVOLVE_H
+#define CONVOLVE_H
+
+#include "Utils.h"
+#include "Border.h"
+#include "Parallel.h"
+#include "SimdKernels.h"
+#include <type_traits>
+
+// Convolution with the mask size, and optionally the taps, known at
+// compile time. A compile-time kernel is a type K with
+//
+//   static constexpr int size;                   // odd edge length N
+//   static constexpr X taps[size * size];        // row-major
+//
+// convolve<K, T>() accumulates in T (int for integer masks, which is
+// exact; float otherwise). The N*N tap loop is expanded at compile time,
+// so each tap is a constant and zero taps drop out entirely. Per-pixel
+// summation order matches the naive (i, j) loop, so results equal
+// convolve_universal() with the same mask.
+
+namespace convolve_detail {
+
+// fn(I), fn(I + 1), ..., fn(N - 1), expanded at compile time
+template <int I, int N>
+struct Unroll {
+    template <typename Fn>
+    static void run(Fn& fn) {
+        fn(I);
+        Unroll<I + 1, N>::run(fn);
+    }
+};
+
+template <int N>
+struct Unroll<N, N> {
+    template <typename Fn>
+    static void run(Fn&) {}
+};
+
+inline unsigned char to_pixel(int sum) {
+    return (unsigned char)clampv(sum, 0, 255);
+}
+
+// Same as clampv((int)round(sum), 0, 255) without the libm call, so the
+// pixel loop stays free of calls
+inline unsigned char to_pixel(float sum) {
+    sum = std::min(std::max(sum, -1.0f), 256.0f);
+    int whole = (int)sum;        // Toward zero
+    float frac = sum - whole;    // Exact
+    whole += (frac >= 0.5f) - (frac <= -0.5f);
+    return (unsigned char)clampv(whole, 0, 255);
+}
+
+// Fixed-point sum with shift fraction bits: round(sum / 2^shift) half
+// away from zero, clamped. Negative sums clamp to 0 whichever way they
+// round, so only the positive side needs the half.
+inline unsigned char to_pixel(int sum, int shift) {
+    int half = (1 << shift) >> 1;
+    return to_pixel(std::max(sum + half, 0) >> shift);
+}
+
+inline unsigned char to_pixel(float sum, int) {
+    return to_pixel(sum);
+}
+
+// Taps of a compile-time kernel
+template <typename K, typename T>
+struct ConstTaps {
+    T operator()(int t) const { return K::taps[t]; }
+    bool zero(int t) const { return K::taps[t] == 0; }
+};
+
+// Taps of a runtime N x N mask, copied so they stay in registers or on
+// the stack instead of behind a vector
+template <int N, typename T>
+struct LocalTaps {
+    T k[N * N];
+
+    explicit LocalTaps(const T* taps) { std::copy(taps, taps + N * N, k); }
+    T operator()(int t) const { return k[t]; }
+    bool zero(int) const { return false; }  // Not known here: no branch per tap
+};
+
+// Interior rows of [y0, y1) of one w x h plane. Pixels go in groups of
+// CONVOLVE_LANES: each pixel's sum is a serial chain of N*N adds, and
+// independent chains side by side keep the FP units busy (and let the
+// compiler pack them into vectors).
+const int CONVOLVE_LANES = 16;
+
+template <int N, typename T, typename Taps>
+void convolve_plane_unrolled(const unsigned char* src, unsigned char* dst, int w, int h,
+                             const Taps& tap, int y0, int y1) {
+    const int M = N / 2, LANES = CONVOLVE_LANES;
+    int len = w - 2 * M;
+    for (int y = std::max(y0, M); y < std::min(y1, h - M); ++y) {
+        const unsigned char* rows[N];
+        for (int i = 0; i < N; ++i) rows[i] = src + (size_t)(y - M + i) * w;
+        unsigned char* d = dst + (size_t)y * w + M;
+        int x = 0;
+        for (; x + LANES <= len; x += LANES) {
+            T sum[LANES] = {};
+            auto add = [&](int t) {
+                if (tap.zero(t)) return;
+                T k = tap(t);
+                const unsigned char* s = rows[t / N] + x + t % N;
+                for (int p = 0; p < LANES; ++p) sum[p] += k * s[p];
+            };
+            Unroll<0, N * N>::run(add);
+            for (int p = 0; p < LANES; ++p) d[x + p] = to_pixel(sum[p]);
+        }
+        for (; x < len; ++x) {
+            T sum = 0;
+            auto add = [&](int t) {
+                if (!tap.zero(t)) sum += tap(t) * rows[t / N][x + t % N];
+            };
+            Unroll<0, N * N>::run(add);
+            d[x] = to_pixel(sum);
+        }
+    }
+}
+
+// Frame pixels of rows [y0, y1): resolved through the border mode, or
+// copied for BORDER_COPY. shift as for to_pixel() with integer taps.
+template <typename T>
+void convolve_plane_frame(const unsigned char* src, unsigned char* dst, int w, int h,
+                          const T* taps, int n, const Border& border, int y0, int y1,
+                          int shift = 0) {
+    int M = n / 2;
+    for_each_frame_pixel(w, h, M, M, y0, y1, [&](int x, int y) {
+        size_t idx = (size_t)y * w + x;
+        if (border.mode == BORDER_COPY) {
+            dst[idx] = src[idx];
+            return;
+        }
+        T sum = 0;
+        const T* k = taps;
+        for (int i = -M; i <= M; ++i) {
+            for (int j = -M; j <= M; ++j, ++k) {
+                sum += *k * border_fetch(src, w, h, x + j, y + i, border);
+            }
+        }
+        dst[idx] = to_pixel(sum, shift);
+    });
+}
+
+// Integer 3x3 masks whose int16 sums cannot overflow go through the SIMD
+// row kernel instead of the unrolled loop
+template <typename K, typename T>
+struct UseSimd3x3 {
+    static constexpr bool value = K::size == 3 && std::is_integral<T>::value &&
+        std::is_same<typename std::remove_const<
+            typename std::remove_extent<decltype(K::taps)>::type>::type, short>::value;
+};
+
+template <typename K>
+bool simd3x3_fits() {
+    int total = 0;
+    for (int t = 0; t < 9; ++t) total += std::abs((int)K::taps[t]);
+    return 255 * total <= 32767;
+}
+
+template <typename K, typename T>
+void convolve_interior(const unsigned char* src, unsigned char* dst, int w, int h,
+                       int y0, int y1, std::true_type) {
+    if (simd_level() == SIMD_SCALAR || !simd3x3_fits<K>()) {
+        convolve_plane_unrolled<3, T>(src, dst, w, h, ConstTaps<K, T>(), y0, y1);
+        return;
+    }
+    for (int y = std::max(y0, 1); y < std::min(y1, h - 1) && w > 2; ++y) {
+        const unsigned char* mid = src + (size_t)y * w + 1;
+        conv3x3_row_u8(mid - w, mid, mid + w, dst + (size_t)y * w + 1, w - 2, K::taps);
+    }
+}
+
+template <typename K, typename T>
+void convolve_interior(const unsigned char* src, unsigned char* dst, int w, int h,
+                       int y0, int y1, std::false_type) {
+    convolve_plane_unrolled<K::size, T>(src, dst, w, h, ConstTaps<K, T>(), y0, y1);
+}
+
+}  // namespace convolve_detail
+
+// src convolved with compile-time kernel K into dst, which is resized to
+// match src and keeps its storage when it already fits. dst may be src
+// (a temporary is used).
+template <typename K, typename T>
+void convolve(const CImg<unsigned char>& src, CImg<unsigned char>& dst,
+              const Border& border = Border(BORDER_COPY)) {
+    static_assert(K::size % 2 == 1, "Kernel size must be odd");
+    if (&dst == &src) {
+        CImg<unsigned char> tmp;
+        convolve<K, T>(src, tmp, border);
+        dst.swap(tmp);
+        return;
+    }
+    int w = src.width(), h = src.height(), s = src.spectrum();
+    dst.assign(w, h, 1, s);
+    T taps[K::size * K::size];
+    for (int t = 0; t < K::size * K::size; ++t) taps[t] = K::taps[t];
+
+    parallel_for_rows(s, h, [&](int c, int y0, int y1) {
+        const unsigned char* sp = src.data(0, 0, 0, c);
+        unsigned char* dp = dst.data(0, 0, 0, c);
+        convolve_detail::convolve_interior<K, T>(
+            sp, dp, w, h, y0, y1,
+            std::integral_constant<bool, convolve_detail::UseSimd3x3<K, T>::value>());
+        convolve_detail::convolve_plane_frame(sp, dp, w, h, taps, K::size, border, y0, y1);
+    });
+}
+
+#endif
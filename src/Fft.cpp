@@ -0,0 +1,87 @@
+#include "Fft.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+int fft_size(int n) {
+    int size = 1;
+    while (size < n) size *= 2;
+    return size;
+}
+
+FftPlan::FftPlan(int n) : n_(n), reversed_(n), twiddle_(n / 2) {
+    if (n < 1 || (n & (n - 1))) throw invalid_argument("FFT size must be a power of two");
+    int bits = 0;
+    while ((1 << bits) < n) ++bits;
+    for (int i = 0; i < n; ++i) {
+        int r = 0;
+        for (int b = 0; b < bits; ++b) r |= ((i >> b) & 1) << (bits - 1 - b);
+        reversed_[i] = r;
+    }
+    const double pi = acos(-1.0);
+    for (int k = 0; k < n / 2; ++k) {
+        twiddle_[k] = Complex(cos(2 * pi * k / n), -sin(2 * pi * k / n));
+    }
+}
+
+// Products written out: std::complex multiplication checks for NaN and
+// infinities and is several times slower
+static inline void butterfly(double& ar, double& ai, double& br, double& bi,
+                             double wr, double wi) {
+    double tr = br * wr - bi * wi;
+    double ti = br * wi + bi * wr;
+    br = ar - tr;
+    bi = ai - ti;
+    ar += tr;
+    ai += ti;
+}
+
+void FftPlan::transform(Complex* data, bool inverse) const {
+    for (int i = 0; i < n_; ++i) {
+        if (i < reversed_[i]) swap(data[i], data[reversed_[i]]);
+    }
+    double* d = reinterpret_cast<double*>(data);  // Complex is (re, im) in order
+    double sign = inverse ? -1 : 1;
+    for (int len = 2; len <= n_; len *= 2) {
+        int half = len / 2, step = n_ / len;
+        for (int start = 0; start < n_; start += len) {
+            for (int k = 0; k < half; ++k) {
+                const Complex& w = twiddle_[k * step];
+                double* a = d + 2 * (start + k);
+                double* b = d + 2 * (start + k + half);
+                butterfly(a[0], a[1], b[0], b[1], w.real(), sign * w.imag());
+            }
+        }
+    }
+}
+
+void FftPlan::transform2d(Complex* data, bool inverse) const {
+    for (int y = 0; y < n_; ++y) transform(data + (size_t)y * n_, inverse);
+
+    // Columns: the same radix-2 steps with whole rows as the elements
+    for (int i = 0; i < n_; ++i) {
+        if (i < reversed_[i]) {
+            swap_ranges(data + (size_t)i * n_, data + (size_t)(i + 1) * n_,
+                        data + (size_t)reversed_[i] * n_);
+        }
+    }
+    double* d = reinterpret_cast<double*>(data);
+    double sign = inverse ? -1 : 1;
+    for (int len = 2; len <= n_; len *= 2) {
+        int half = len / 2, step = n_ / len;
+        for (int start = 0; start < n_; start += len) {
+            for (int k = 0; k < half; ++k) {
+                const Complex& w = twiddle_[k * step];
+                double wr = w.real(), wi = sign * w.imag();
+                double* a = d + 2 * (size_t)(start + k) * n_;
+                double* b = d + 2 * (size_t)(start + k + half) * n_;
+                for (int x = 0; x < 2 * n_; x += 2) {
+                    butterfly(a[x], a[x + 1], b[x], b[x + 1], wr, wi);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <complex>
+#include <vector>
+
+// Radix-2 complex FFT in double precision, for the FFT convolution path.
+// A plan holds the twiddles and bit-reversal order of one power-of-two
+// size and is read-only after construction, so threads can share it.
+
+class FftPlan {
+public:
+    typedef std::complex<double> Complex;
+
+    explicit FftPlan(int n);  // n must be a power of two
+
+    int size() const { return n_; }
+
+    // In place over n contiguous points. The inverse is unscaled:
+    // forward then inverse multiplies by n.
+    void transform(Complex* data, bool inverse) const;
+
+    // In place over an n x n row-major grid: all rows, then the columns,
+    // whose butterflies run across whole rows so every pass is sequential
+    void transform2d(Complex* data, bool inverse) const;
+
+private:
+    int n_;
+    std::vector<int> reversed_;    // Bit-reversed index of each point
+    std::vector<Complex> twiddle_; // exp(-2 pi i k / n), k < n / 2
+};
+
+// Smallest power of two >= n
+int fft_size(int n);
+
+#endif
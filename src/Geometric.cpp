@@ -0,0 +1,92 @@
+#include "Geometric.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+void op_hflip(const CImg<unsigned char>& src, CImg<unsigned char>& dst) {
+    int w = src.width();
+    if (&dst != &src) dst.assign(w, src.height(), 1, src.spectrum());
+    parallel_for_rows(src.spectrum(), src.height(), [&](int c, int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            const unsigned char* s = src.data(0, y, 0, c);
+            unsigned char* d = dst.data(0, y, 0, c);
+            if (d == s) reverse(d, d + w);
+            else reverse_copy(s, s + w, d);
+        }
+    });
+}
+
+void op_vflip(const CImg<unsigned char>& src, CImg<unsigned char>& dst) {
+    int w = src.width(), h = src.height();
+    if (&dst == &src) {
+        // Swap row pairs: rows [0, h / 2) with their mirror images
+        parallel_for_rows(src.spectrum(), h / 2, [&](int c, int y0, int y1) {
+            for (int y = y0; y < y1; ++y) {
+                swap_ranges(dst.data(0, y, 0, c), dst.data(0, y, 0, c) + w,
+                            dst.data(0, h - 1 - y, 0, c));
+            }
+        });
+        return;
+    }
+    dst.assign(w, h, 1, src.spectrum());
+    parallel_for_rows(src.spectrum(), h, [&](int c, int y0, int y1) {
+        for (int y = y0; y < y1; ++y) memcpy(dst.data(0, y, 0, c), src.data(0, h - 1 - y, 0, c), w);
+    });
+}
+
+void op_dflip(const CImg<unsigned char>& src, CImg<unsigned char>& dst) {
+    if (&dst == &src) {
+        CImg<unsigned char> tmp;
+        op_dflip(src, tmp);
+        dst.swap(tmp);
+        return;
+    }
+    int w = src.width(), h = src.height();
+    dst.assign(h, w, 1, src.spectrum());
+    // Row y of dst is column y of src
+    parallel_for_rows(src.spectrum(), w, [&](int c, int y0, int y1) {
+        const unsigned char* s = src.data(0, 0, 0, c);
+        for (int y = y0; y < y1; ++y) {
+            unsigned char* d = dst.data(0, y, 0, c);
+            for (int x = 0; x < h; ++x) d[x] = s[(size_t)x * w + y];
+        }
+    });
+}
+
+CImg<unsigned char> op_hflip(const CImg<unsigned char>& src) {
+    CImg<unsigned char> out;
+    op_hflip(src, out);
+    return out;
+}
+
+CImg<unsigned char> op_vflip(const CImg<unsigned char>& src) {
+    CImg<unsigned char> out;
+    op_vflip(src, out);
+    return out;
+}
+
+CImg<unsigned char> op_dflip(const CImg<unsigned char>& src) {
+    CImg<unsigned char> out;
+    op_dflip(src, out);
+    return out;
+}
+
+static CImg<unsigned char> scale_nearest(const CImg<unsigned char>& src, float factor) {
+    int w = max(1, (int)lround(src.width() * factor));
+    int h = max(1, (int)lround(src.height() * factor));
+    return src.get_resize(w, h, 1, src.spectrum(), 1);  // 1: nearest neighbour
+}
+
+CImg<unsigned char> op_shrink(const CImg<unsigned char>& src, float factor) {
+    if (factor <= 0.0f || factor >= 1.0f) throw runtime_error("Shrink factor must be in (0, 1)");
+    return scale_nearest(src, factor);
+}
+
+CImg<unsigned char> op_enlarge(const CImg<unsigned char>& src, float factor) {
+    if (factor <= 1.0f) throw runtime_error("Enlarge factor must be > 1.0");
+    return scale_nearest(src, factor);
+}
@@ -0,0 +1,24 @@
+#ifndef GEOMETRIC_H
+#define GEOMETRIC_H
+
+#include "Utils.h"
+
+// Flips and nearest-neighbour resizing used by ImageProcessor. Each op
+// returns a new image.
+
+CImg<unsigned char> op_hflip(const CImg<unsigned char>& src);  // Mirror left/right
+CImg<unsigned char> op_vflip(const CImg<unsigned char>& src);  // Mirror top/bottom
+CImg<unsigned char> op_dflip(const CImg<unsigned char>& src);  // Transpose: w x h becomes h x w
+
+// Same, writing into dst (storage reused when it already has the size;
+// may be src, the flips then run in place without allocating)
+void op_hflip(const CImg<unsigned char>& src, CImg<unsigned char>& dst);
+void op_vflip(const CImg<unsigned char>& src, CImg<unsigned char>& dst);
+void op_dflip(const CImg<unsigned char>& src, CImg<unsigned char>& dst);
+
+// Both edges scaled by factor (rounded, at least 1 pixel): 0 < factor < 1
+// for shrink, factor > 1 for enlarge. Throws runtime_error otherwise.
+CImg<unsigned char> op_shrink(const CImg<unsigned char>& src, float factor);
+CImg<unsigned char> op_enlarge(const CImg<unsigned char>& src, float factor);
+
+#endif
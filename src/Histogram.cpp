@@ -1,25 +1,105 @@
 #include "Histogram.h"
+#include "Parallel.h"
+#include "SimdKernels.h"
 #include <iostream>
 #include <iomanip>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
 
 using namespace std;
 
-vector<int> compute_histogram(const CImg<unsigned char>& src, int channel) {
-    vector<int> hist(256, 0);
-    cimg_forXY(src, x, y) {
-        hist[src(x, y, channel)]++;
+// Count n pixels of s interleaved channels into four sub-histograms per
+// channel (sub[4 * c + k]), taking turns pixel by pixel, so runs of equal
+// values do not serialize on one counter (store-to-load forwarding).
+// 32-bit counters are safe: callers pass at most one row band.
+static void count_pixels(const unsigned char* p, size_t n, int s, uint32_t (*sub)[256]) {
+    if (s == 1) {
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            ++sub[0][p[i]];
+            ++sub[1][p[i + 1]];
+            ++sub[2][p[i + 2]];
+            ++sub[3][p[i + 3]];
+        }
+        for (; i < n; ++i) ++sub[0][p[i]];
+        return;
+    }
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4, p += 4 * s) {
+        for (int c = 0; c < s; ++c) {
+            uint32_t (*h)[256] = sub + 4 * c;
+            ++h[0][p[c]];
+            ++h[1][p[s + c]];
+            ++h[2][p[2 * s + c]];
+            ++h[3][p[3 * s + c]];
+        }
+    }
+    for (; i < n; ++i, p += s) {
+        for (int c = 0; c < s; ++c) ++sub[4 * c][p[c]];
     }
-    return hist;
 }
 
-CImg<unsigned char> histogram_power23(const CImg<unsigned char>& src, 
-                                       int gmin, int gmax) {
-    int w = src.width(), h = src.height(), s = src.spectrum();
-    int N = w * h;
-    CImg<unsigned char> out(w, h, 1, s);
-    
-    for (int c = 0; c < s; ++c) {
-        auto hist = compute_histogram(src, c);
+// Histograms of planes buffers of h rows, each row w pixels of s
+// interleaved channels, stride bytes apart: plane(c) is the first row of
+// buffer c. Row bands are counted in parallel into private sub-histograms
+// and merged once all bands are done. Returns planes * s histograms.
+template <typename PlaneFn>
+static vector<vector<uint64_t>> count_histograms(int planes, int w, int h, int s,
+                                                 size_t stride, PlaneFn plane) {
+    vector<vector<uint64_t>> hists(planes * s, vector<uint64_t>(256, 0));
+    mutex merge;
+
+    parallel_for_rows(planes, h, [&](int c, int y0, int y1) {
+        vector<uint32_t> bins(4 * 256 * (size_t)s, 0);
+        uint32_t (*sub)[256] = reinterpret_cast<uint32_t (*)[256]>(bins.data());
+        const unsigned char* p = plane(c) + stride * y0;
+        if (stride == (size_t)w * s) {
+            count_pixels(p, (size_t)(y1 - y0) * w, s, sub);  // Contiguous band
+        } else {
+            for (int y = y0; y < y1; ++y, p += stride) count_pixels(p, w, s, sub);
+        }
+
+        lock_guard<mutex> lock(merge);
+        for (int k = 0; k < s; ++k) {
+            vector<uint64_t>& dst = hists[c * s + k];
+            const uint32_t (*h4)[256] = sub + 4 * k;
+            for (int v = 0; v < 256; ++v) {
+                dst[v] += (uint64_t)h4[0][v] + h4[1][v] + h4[2][v] + h4[3][v];
+            }
+        }
+    });
+    return hists;
+}
+
+vector<vector<uint64_t>> compute_histograms(const CImg<unsigned char>& src) {
+    return count_histograms(src.spectrum(), src.width(), src.height(), 1, src.width(),
+                            [&](int c) { return src.data(0, 0, 0, c); });
+}
+
+vector<vector<uint64_t>> compute_histograms(const unsigned char* data, int width, int height,
+                                            int channels, size_t stride) {
+    return count_histograms(1, width, height, channels, stride,
+                            [data](int) { return data; });
+}
+
+vector<uint64_t> compute_histogram(const CImg<unsigned char>& src, int channel) {
+    if (channel < 0 || channel >= src.spectrum()) {
+        throw runtime_error("Channel out of range");
+    }
+    const CImg<unsigned char> plane = src.get_shared_channel(channel);
+    return compute_histograms(plane)[0];
+}
+
+vector<vector<unsigned char>> power23_luts(const vector<vector<uint64_t>>& hists,
+                                           int gmin, int gmax) {
+    // The output depends only on the input level, so each channel gets a
+    // 256-entry table and the per-pixel work is a single lookup
+    vector<vector<unsigned char>> luts(hists.size(), vector<unsigned char>(256));
+    for (size_t c = 0; c < hists.size(); ++c) {
+        const vector<uint64_t>& hist = hists[c];
+        uint64_t N = 0;
+        for (int i = 0; i < 256; ++i) N += hist[i];
         
         // Build CDF lookup table
         vector<float> cdf(256);
@@ -28,26 +108,43 @@ CImg<unsigned char> histogram_power23(const CImg<unsigned char>& src,
             cdf[i] = cdf[i-1] + (float)hist[i] / N;
         }
         
-        // Apply power 2/3 transformation
+        // Power 2/3 transformation of every level
         float gmin_third = pow((float)gmin, 1.0f/3.0f);
         float gmax_third = pow((float)gmax, 1.0f/3.0f);
-        
-        cimg_forXY(src, x, y) {
-            int f = src(x, y, c);
+        for (int f = 0; f < 256; ++f) {
             float g_third = gmin_third + (gmax_third - gmin_third) * cdf[f];
             int g = (int)round(pow(g_third, 3.0f));
-            out(x, y, c) = (unsigned char)clampv(g, 0, 255);
+            luts[c][f] = (unsigned char)clampv(g, 0, 255);
         }
     }
+    return luts;
+}
+
+void histogram_power23(const CImg<unsigned char>& src, CImg<unsigned char>& out,
+                       int gmin, int gmax) {
+    int w = src.width(), h = src.height(), s = src.spectrum();
+    auto luts = power23_luts(compute_histograms(src), gmin, gmax);
+    out.assign(w, h, 1, s);  // After the histogram pass: out may be src
+    
+    parallel_for_rows(s, h, [&](int c, int y0, int y1) {
+        apply_lut_u8(src.data(0, y0, 0, c), out.data(0, y0, 0, c),
+                     (size_t)(y1 - y0) * w, luts[c].data());
+    });
+}
+
+CImg<unsigned char> histogram_power23(const CImg<unsigned char>& src, 
+                                       int gmin, int gmax) {
+    CImg<unsigned char> out;
+    histogram_power23(src, out, gmin, gmax);
     return out;
 }
 
-void save_histogram_image(const vector<int>& hist, const string& outputPath) {
+void save_histogram_image(const vector<uint64_t>& hist, const string& outputPath) {
     int width = 512, height = 300;
     CImg<unsigned char> img(width, height, 1, 1, 255);
     
     // Find max value for scaling
-    int maxVal = *max_element(hist.begin(), hist.end());
+    uint64_t maxVal = *max_element(hist.begin(), hist.end());
     if (maxVal == 0) maxVal = 1;
     
     // Draw histogram bars
@@ -61,71 +158,178 @@ void save_histogram_image(const vector<int>& hist, const string& outputPath) {
     }
     
     img.save(outputPath.c_str());
-    cout << "Histogram saved to: " << outputPath << endl;
 }
 
-ImageCharacteristics compute_characteristics(const CImg<unsigned char>& src, 
-                                             int channel) {
-    auto hist = compute_histogram(src, channel);
-    int N = src.width() * src.height();
-    ImageCharacteristics ch;
+ImageCharacteristics characteristics_from_histogram(const vector<uint64_t>& hist) {
+    ImageCharacteristics ch = {0, 0, 0, 0, 0, 0, 0, 0};
     
-    // C1: Mean
-    ch.mean = 0.0;
+    // First sweep over the bins: count, exact sum for the mean, C5 and C6
+    uint64_t N = 0, S1 = 0;
+    double sum_sq = 0.0, sum_hlogh = 0.0;
     for (int m = 0; m < 256; ++m) {
-        ch.mean += m * hist[m];
+        uint64_t h = hist[m];
+        if (h == 0) continue;
+        N += h;
+        S1 += h * m;
+        sum_sq += (double)h * h;
+        sum_hlogh += h * log2((double)h);
     }
-    ch.mean /= N;
+    if (N == 0) return ch;
     
-    // C1: Variance
-    ch.variance = 0.0;
+    // Second sweep: central moments around the mean. Not from the raw
+    // power sums, which cancel catastrophically on near-constant channels.
+    double n = (double)N;
+    double mean = S1 / n, mu2 = 0.0, mu3 = 0.0, mu4 = 0.0;
     for (int m = 0; m < 256; ++m) {
-        double diff = m - ch.mean;
-        ch.variance += diff * diff * hist[m];
+        if (hist[m] == 0) continue;
+        double diff = m - mean;
+        mu2 += diff * diff * hist[m];
+        mu3 += diff * diff * diff * hist[m];
+        mu4 += diff * diff * diff * diff * hist[m];
     }
-    ch.variance /= N;
     
-    // C2: Standard deviation
-    ch.stdev = sqrt(ch.variance);
+    // C1: Mean and variance
+    ch.mean = mean;
+    ch.variance = mu2 / n;
     
-    // C2: Variation coefficient I
+    // C2: Standard deviation and variation coefficient I
+    ch.stdev = sqrt(ch.variance);
     ch.varcoeff_I = (ch.mean > 0) ? ch.stdev / ch.mean : 0.0;
     
-    // C3: Asymmetry coefficient
-    ch.asymmetry = 0.0;
+    // C3/C4: Asymmetry and flattening from the third and fourth central moments
     if (ch.stdev > 0) {
-        for (int m = 0; m < 256; ++m) {
-            double diff = m - ch.mean;
-            ch.asymmetry += diff * diff * diff * hist[m];
-        }
-        ch.asymmetry /= (N * ch.stdev * ch.stdev * ch.stdev);
+        ch.asymmetry = mu3 / (n * ch.stdev * ch.stdev * ch.stdev);
+        ch.flattening = mu4 / (n * ch.variance * ch.variance) - 3.0;
     }
     
-    // C4: Flattening coefficient
-    ch.flattening = 0.0;
-    if (ch.stdev > 0) {
-        for (int m = 0; m < 256; ++m) {
-            double diff = m - ch.mean;
-            ch.flattening += diff * diff * diff * diff * hist[m];
-        }
-        ch.flattening = ch.flattening / (N * ch.variance * ch.variance) - 3.0;
-    }
+    // C5: Variation coefficient II = sum (h/N)^2
+    ch.varcoeff_II = sum_sq / (n * n);
     
-    // C5: Variation coefficient II - FIXED
-    ch.varcoeff_II = 0.0;
-    for (int m = 0; m < 256; ++m) {
-        double h_normalized = (double)hist[m] / N;
-        ch.varcoeff_II += h_normalized * h_normalized;
-    }
+    // C6: Entropy = -sum p log2 p = log2 N - sum h log2 h / N
+    ch.entropy = log2(n) - sum_hlogh / n;
     
-    // C6: Entropy
-    ch.entropy = 0.0;
-    for (int m = 0; m < 256; ++m) {
-        if (hist[m] > 0) {
-            double p = (double)hist[m] / N;
-            ch.entropy -= p * log2(p);
+    return ch;
+}
+
+ImageCharacteristics compute_characteristics(const CImg<unsigned char>& src, 
+                                             int channel) {
+    return characteristics_from_histogram(compute_histogram(src, channel));
+}
+
+vector<RegionCharacteristics> compute_region_characteristics(
+        const CImg<unsigned char>& src, int x, int y, int width, int height,
+        int tileW, int tileH) {
+    // Clip the region to the image
+    int x1 = min(src.width(), x + width), y1 = min(src.height(), y + height);
+    x = max(0, x);
+    y = max(0, y);
+    if (x >= x1 || y >= y1) throw runtime_error("Region is outside the image");
+    width = x1 - x;
+    height = y1 - y;
+    if (tileW <= 0) tileW = width;
+    if (tileH <= 0) tileH = height;
+    
+    int cols = (width + tileW - 1) / tileW, rows = (height + tileH - 1) / tileH;
+    int s = src.spectrum();
+    vector<RegionCharacteristics> results(cols * rows * s);
+    
+    // Each task histograms one tile of one channel: a single pass overall
+    parallel_for(cols * rows * s, [&](int i) {
+        int c = i % s, tile = i / s;
+        int tx = x + (tile % cols) * tileW, ty = y + (tile / cols) * tileH;
+        int tw = min(tileW, x1 - tx), th = min(tileH, y1 - ty);
+        
+        uint32_t sub[4][256] = {};
+        vector<uint64_t> hist(256, 0);
+        for (int yy = ty; yy < ty + th; ++yy) {
+            count_pixels(src.data(tx, yy, 0, c), tw, 1, sub);
+            // Flush before the 32-bit counters could overflow
+            if ((uint64_t)(yy - ty + 1) * tw >= (1u << 30) || yy == ty + th - 1) {
+                for (int v = 0; v < 256; ++v) {
+                    hist[v] += (uint64_t)sub[0][v] + sub[1][v] + sub[2][v] + sub[3][v];
+                }
+                memset(sub, 0, sizeof(sub));
+            }
+        }
+        
+        RegionCharacteristics& r = results[i];
+        r.x = tx;
+        r.y = ty;
+        r.width = tw;
+        r.height = th;
+        r.channel = c;
+        r.ch = characteristics_from_histogram(hist);
+    });
+    return results;
+}
+
+void write_characteristics(ostream& os, const string& image,
+                           const vector<RegionCharacteristics>& results,
+                           CharacteristicsFormat format, bool header) {
+    ios_base::fmtflags flags = os.flags();
+    streamsize precision = os.precision();
+    
+    if (format == FORMAT_CSV) {
+        if (header) os << "image,x,y,width,height,channel,mean,variance,stdev,varcoeff_I,"
+                        "asymmetry,flattening,varcoeff_II,entropy\n";
+        os << setprecision(10);
+        for (const auto& r : results) {
+            const ImageCharacteristics& ch = r.ch;
+            os << image << ',' << r.x << ',' << r.y << ',' << r.width << ','
+               << r.height << ',' << r.channel << ',' << ch.mean << ','
+               << ch.variance << ',' << ch.stdev << ',' << ch.varcoeff_I << ','
+               << ch.asymmetry << ',' << ch.flattening << ','
+               << ch.varcoeff_II << ',' << ch.entropy << '\n';
+        }
+    } else if (format == FORMAT_JSON) {
+        // Paths are the only strings; escape what JSON requires
+        string escaped;
+        for (char c : image) {
+            if (c == '"' || c == '\\') escaped += '\\';
+            escaped += c;
+        }
+        os << setprecision(10);
+        os << "{\"image\": \"" << escaped << "\", \"results\": [";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const RegionCharacteristics& r = results[i];
+            const ImageCharacteristics& ch = r.ch;
+            os << (i ? ",\n  " : "\n  ")
+               << "{\"x\": " << r.x << ", \"y\": " << r.y
+               << ", \"width\": " << r.width << ", \"height\": " << r.height
+               << ", \"channel\": " << r.channel
+               << ", \"mean\": " << ch.mean << ", \"variance\": " << ch.variance
+               << ", \"stdev\": " << ch.stdev << ", \"varcoeff_I\": " << ch.varcoeff_I
+               << ", \"asymmetry\": " << ch.asymmetry
+               << ", \"flattening\": " << ch.flattening
+               << ", \"varcoeff_II\": " << ch.varcoeff_II
+               << ", \"entropy\": " << ch.entropy << "}";
+        }
+        os << "\n]}\n";
+    } else {
+        // Label regions only when there is more than one tile
+        bool tiled = false;
+        for (const auto& r : results) {
+            tiled |= r.x != results[0].x || r.y != results[0].y;
+        }
+        os << fixed << setprecision(4);
+        for (const auto& r : results) {
+            const ImageCharacteristics& ch = r.ch;
+            os << "\nImage Characteristics (Channel " << r.channel;
+            if (tiled) {
+                os << ", Region " << r.x << "," << r.y << " " << r.width << "x" << r.height;
+            }
+            os << "):\n";
+            os << "  Mean (C1):              " << ch.mean << "\n";
+            os << "  Variance (C1):          " << ch.variance << "\n";
+            os << "  Std Deviation (C2):     " << ch.stdev << "\n";
+            os << "  Var Coefficient I (C2): " << ch.varcoeff_I << "\n";
+            os << "  Asymmetry (C3):         " << ch.asymmetry << "\n";
+            os << "  Flattening (C4):        " << ch.flattening << "\n";
+            os << "  Var Coefficient II (C5):" << ch.varcoeff_II << "\n";
+            os << "  Entropy (C6):           " << ch.entropy << " bits\n";
         }
     }
     
-    return ch;
+    os.flags(flags);
+    os.precision(precision);
 }
@@ -2,17 +2,37 @@
 #define HISTOGRAM_H
 
 #include "Utils.h"
+#include <cstdint>
+#include <ostream>
 #include <vector>
 
+// Histograms of all channels in one pass over the planar buffer
+// (row bands in parallel, 64-bit counts)
+std::vector<std::vector<uint64_t>> compute_histograms(const CImg<unsigned char>& src);
+
+// Same engine over an interleaved buffer: pixel (x, y) is channels bytes
+// at data + y * stride + x * channels. One histogram per channel.
+std::vector<std::vector<uint64_t>> compute_histograms(const unsigned char* data, int width,
+                                                      int height, int channels, size_t stride);
+
 // Compute histogram for a single channel
-std::vector<int> compute_histogram(const CImg<unsigned char>& src, int channel);
+std::vector<uint64_t> compute_histogram(const CImg<unsigned char>& src, int channel);
+
+// H4 level mapping of every channel from its histogram: one 256-entry
+// table per channel
+std::vector<std::vector<unsigned char>> power23_luts(
+        const std::vector<std::vector<uint64_t>>& hists, int gmin, int gmax);
 
 // H4: Power 2/3 equalization
 CImg<unsigned char> histogram_power23(const CImg<unsigned char>& src, 
                                        int gmin = 0, int gmax = 255);
 
+// Same, writing into dst (storage reused when it already fits; may be src)
+void histogram_power23(const CImg<unsigned char>& src, CImg<unsigned char>& dst,
+                       int gmin = 0, int gmax = 255);
+
 // Save histogram as image
-void save_histogram_image(const std::vector<int>& hist, 
+void save_histogram_image(const std::vector<uint64_t>& hist, 
                           const std::string& outputPath);
 
 // Image characteristics structure
@@ -27,8 +47,39 @@ struct ImageCharacteristics {
     double entropy;        // C6
 };
 
+// C1-C6 from a histogram: the pixels are only counted once, whatever
+// the number of characteristics; two short sweeps over the 256 bins
+ImageCharacteristics characteristics_from_histogram(const std::vector<uint64_t>& hist);
+
 // Compute all characteristics
 ImageCharacteristics compute_characteristics(const CImg<unsigned char>& src, 
                                              int channel = 0);
 
+// Characteristics of one channel inside a rectangle of the image
+struct RegionCharacteristics {
+    int x, y, width, height;
+    int channel;
+    ImageCharacteristics ch;
+};
+
+// All channels of the rectangle (x, y, width, height), clipped to the image
+// and split into tileW x tileH tiles (0 = one tile). Ordered tile by tile,
+// channels innermost. One histogram pass over the pixels.
+std::vector<RegionCharacteristics> compute_region_characteristics(
+        const CImg<unsigned char>& src, int x, int y, int width, int height,
+        int tileW = 0, int tileH = 0);
+
+enum CharacteristicsFormat {
+    FORMAT_TEXT,
+    FORMAT_CSV,
+    FORMAT_JSON
+};
+
+// Text matches the single-channel report; CSV/JSON have one record per
+// tile and channel, tagged with the image name. header=false drops the CSV
+// column line so reports of several images can be concatenated.
+void write_characteristics(std::ostream& os, const std::string& image,
+                           const std::vector<RegionCharacteristics>& results,
+                           CharacteristicsFormat format, bool header = true);
+
 #endif
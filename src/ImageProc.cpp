@@ -0,0 +1,296 @@
+#include "ImageProc.h"
+#include "Geometric.h"
+#include "Histogram.h"
+#include "LinearFilters.h"
+#include "NoiseFilters.h"
+#include "NonLinearFilters.h"
+#include "Operations.h"
+#include "Parallel.h"
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+namespace imageproc {
+
+static void check_view(const ImageView& v, const char* what) {
+    if (!v.data || v.width <= 0 || v.height <= 0 || v.channels <= 0 ||
+        v.stride < (size_t)v.width * v.channels) {
+        throw invalid_argument(string("imageproc: invalid ") + what + " view");
+    }
+}
+
+static void check_views(const ImageView& src, const MutableImageView& dst) {
+    check_view(src, "source");
+    check_view(dst, "destination");
+    if (dst.width != src.width || dst.height != src.height || dst.channels != src.channels) {
+        throw invalid_argument("imageproc: destination does not match the source");
+    }
+}
+
+static ::Border to_border(BorderMode mode, int value, ::BorderMode fallback) {
+    switch (mode) {
+        case BORDER_CLAMP:    return ::Border(::BORDER_CLAMP, value);
+        case BORDER_MIRROR:   return ::Border(::BORDER_MIRROR, value);
+        case BORDER_WRAP:     return ::Border(::BORDER_WRAP, value);
+        case BORDER_CONSTANT: return ::Border(::BORDER_CONSTANT, value);
+        case BORDER_COPY:     return ::Border(::BORDER_COPY, value);
+        case BORDER_DEFAULT:  return ::Border(fallback, value);
+    }
+    throw invalid_argument("imageproc: invalid border mode");
+}
+
+// Interleaved view -> planar image (storage reused across calls)
+static void to_planar(const ImageView& src, CImg<unsigned char>& dst) {
+    int w = src.width, s = src.channels;
+    dst.assign(w, src.height, 1, s);
+    parallel_for_rows(1, src.height, [&](int, int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            const unsigned char* p = src.data + src.stride * y;
+            for (int c = 0; c < s; ++c) {
+                unsigned char* d = dst.data(0, y, 0, c);
+                for (int x = 0; x < w; ++x) d[x] = p[x * s + c];
+            }
+        }
+    });
+}
+
+static void from_planar(const CImg<unsigned char>& src, const MutableImageView& dst) {
+    int w = dst.width, s = dst.channels;
+    parallel_for_rows(1, dst.height, [&](int, int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            unsigned char* p = dst.data + dst.stride * y;
+            for (int c = 0; c < s; ++c) {
+                const unsigned char* r = src.data(0, y, 0, c);
+                for (int x = 0; x < w; ++x) p[x * s + c] = r[x];
+            }
+        }
+    });
+}
+
+// Run filter(planarIn, planarOut) between the caller's buffers; filter
+// must give out dst's size. Both planar images stay allocated per thread,
+// so repeated calls on frames of one size do not allocate.
+template <typename Filter>
+static void convert_planar(const ImageView& src, const MutableImageView& dst, Filter filter) {
+    static thread_local CImg<unsigned char> in, out;
+    to_planar(src, in);
+    filter(in, out);
+    from_planar(out, dst);
+}
+
+// Same, for filters that keep the size
+template <typename Filter>
+static void run_planar(const ImageView& src, const MutableImageView& dst, Filter filter) {
+    check_views(src, dst);
+    convert_planar(src, dst, filter);
+}
+
+// dst(x, y, c) = luts[c][src(x, y, c)] on the interleaved rows directly
+static void remap_levels(const ImageView& src, const MutableImageView& dst,
+                         const vector<const unsigned char*>& luts) {
+    int w = src.width, s = src.channels;
+    parallel_for_rows(1, src.height, [&](int, int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            const unsigned char* p = src.data + src.stride * y;
+            unsigned char* d = dst.data + dst.stride * y;
+            for (int x = 0; x < w; ++x, p += s, d += s) {
+                for (int c = 0; c < s; ++c) d[c] = luts[c][p[c]];
+            }
+        }
+    });
+}
+
+// A per-channel point op: its tables come from op applied to a ramp of
+// every level, as in ImageProcessor
+template <typename Op>
+static void map_levels(const ImageView& src, const MutableImageView& dst, Op op) {
+    check_views(src, dst);
+    CImg<unsigned char> ramp(256, 1, 1, src.channels);
+    cimg_forXC(ramp, x, c) ramp(x, 0, 0, c) = (unsigned char)x;
+    CImg<unsigned char> tables = op(ramp);
+    vector<const unsigned char*> luts(src.channels);
+    for (int c = 0; c < src.channels; ++c) luts[c] = tables.data(0, 0, 0, c);
+    remap_levels(src, dst, luts);
+}
+
+int api_version() {
+    return IMAGEPROC_API_VERSION;
+}
+
+void set_thread_count(int threads) {
+    ::set_thread_count(threads);
+}
+
+void histograms(const ImageView& src, uint64_t* hist) {
+    check_view(src, "source");
+    if (!hist) throw invalid_argument("imageproc: null histogram buffer");
+    // The CLI's counting engine, run on the interleaved rows in place
+    vector<vector<uint64_t>> hists = compute_histograms(src.data, src.width, src.height,
+                                                        src.channels, src.stride);
+    for (int c = 0; c < src.channels; ++c) {
+        memcpy(hist + 256 * c, hists[c].data(), sizeof(uint64_t) * 256);
+    }
+}
+
+Characteristics characteristics(const ImageView& src, int channel) {
+    check_view(src, "source");
+    if (channel < 0 || channel >= src.channels) {
+        throw invalid_argument("imageproc: channel out of range");
+    }
+    vector<uint64_t> all(256 * (size_t)src.channels);
+    histograms(src, all.data());
+    vector<uint64_t> hist(all.begin() + 256 * channel, all.begin() + 256 * (channel + 1));
+
+    ImageCharacteristics ch = characteristics_from_histogram(hist);
+    Characteristics out = { ch.mean, ch.variance, ch.stdev, ch.varcoeff_I,
+                            ch.asymmetry, ch.flattening, ch.varcoeff_II, ch.entropy };
+    return out;
+}
+
+void histogram_power23(const ImageView& src, const MutableImageView& dst, int gmin, int gmax) {
+    // A per-channel level mapping: applied on the interleaved rows directly
+    check_views(src, dst);
+    vector<vector<unsigned char>> tables = power23_luts(
+        compute_histograms(src.data, src.width, src.height, src.channels, src.stride),
+        gmin, gmax);
+    vector<const unsigned char*> luts;
+    for (const auto& t : tables) luts.push_back(t.data());
+    remap_levels(src, dst, luts);
+}
+
+void edge_sharpen(const ImageView& src, const MutableImageView& dst, int variant,
+                  BorderMode border, int borderValue) {
+    if (variant < 0 || variant > 3) throw invalid_argument("imageproc: edge sharpening variant must be 0-3");
+    ::Border b = to_border(border, borderValue, variant == 0 ? ::BORDER_CLAMP : ::BORDER_COPY);
+    run_planar(src, dst, [&](const CImg<unsigned char>& in, CImg<unsigned char>& out) {
+        switch (variant) {
+            case 1:  edge_sharpen_type1(in, out, b); break;
+            case 2:  edge_sharpen_type2(in, out, b); break;
+            case 3:  edge_sharpen_type3(in, out, b); break;
+            default: edge_sharpen_optimized(in, out, b); break;
+        }
+    });
+}
+
+void convolve(const ImageView& src, const MutableImageView& dst, const float* kernel,
+              int size, BorderMode border, int borderValue) {
+    if (!kernel || size <= 0) throw invalid_argument("imageproc: invalid convolution mask");
+    vector<vector<float>> mask(size, vector<float>(size));
+    for (int i = 0; i < size; ++i) {
+        for (int j = 0; j < size; ++j) mask[i][j] = kernel[i * size + j];
+    }
+    ::Border b = to_border(border, borderValue, ::BORDER_COPY);
+    run_planar(src, dst, [&](const CImg<unsigned char>& in, CImg<unsigned char>& out) {
+        convolve_universal(in, out, mask, b);
+    });
+}
+
+void rosenfeld(const ImageView& src, const MutableImageView& dst, int P,
+               RosenfeldDirection direction, BorderMode border, int borderValue) {
+    if (P < 1) throw invalid_argument("imageproc: Rosenfeld P must be at least 1");
+    ::RosenfeldDirection dir = direction == ROSENFELD_VERTICAL ? ::ROSENFELD_VERTICAL
+                             : direction == ROSENFELD_BOTH     ? ::ROSENFELD_BOTH
+                                                               : ::ROSENFELD_HORIZONTAL;
+    ::Border b = to_border(border, borderValue, ::BORDER_CLAMP);
+    run_planar(src, dst, [&](const CImg<unsigned char>& in, CImg<unsigned char>& out) {
+        rosenfeld_operator(in, out, P, b, dir);
+    });
+}
+
+void arithmetic_mean(const ImageView& src, const MutableImageView& dst, int kernelSize,
+                     BorderMode border, int borderValue) {
+    if (kernelSize < 3 || kernelSize % 2 == 0) throw invalid_argument("imageproc: kernel size must be odd and >= 3");
+    ::Border b = to_border(border, borderValue, ::BORDER_CLAMP);
+    run_planar(src, dst, [&](const CImg<unsigned char>& in, CImg<unsigned char>& out) {
+        box_filter(in, out, kernelSize / 2, kernelSize / 2, b);
+    });
+}
+
+void gaussian_blur(const ImageView& src, const MutableImageView& dst, float sigma,
+                   BorderMode border, int borderValue) {
+    if (!(sigma > 0 && sigma <= GAUSSIAN_MAX_SIGMA)) throw invalid_argument("imageproc: sigma must be in (0, 1000]");
+    ::Border b = to_border(border, borderValue, ::BORDER_CLAMP);
+    run_planar(src, dst, [&](const CImg<unsigned char>& in, CImg<unsigned char>& out) {
+        ::gaussian_blur(in, out, sigma, b);
+    });
+}
+
+void median(const ImageView& src, const MutableImageView& dst, int kernelSize,
+            BorderMode border, int borderValue) {
+    if (kernelSize < 3 || kernelSize % 2 == 0 || kernelSize > MEDIAN_MAX_SIZE) {
+        throw invalid_argument("imageproc: median kernel size must be odd and in [3, 255]");
+    }
+    ::Border b = to_border(border, borderValue, ::BORDER_CLAMP);
+    run_planar(src, dst, [&](const CImg<unsigned char>& in, CImg<unsigned char>& out) {
+        median_filter(in, out, kernelSize / 2, b);
+    });
+}
+
+void adaptive_median(const ImageView& src, const MutableImageView& dst, int kernelSize,
+                     int smax, BorderMode border, int borderValue) {
+    if (kernelSize < 3 || kernelSize % 2 == 0 || smax < kernelSize || smax % 2 == 0 ||
+        smax > MEDIAN_MAX_SIZE) {
+        throw invalid_argument("imageproc: need odd 3 <= kernel size <= smax <= 255");
+    }
+    ::Border b = to_border(border, borderValue, ::BORDER_CLAMP);
+    run_planar(src, dst, [&](const CImg<unsigned char>& in, CImg<unsigned char>& out) {
+        ::adaptive_median(in, out, kernelSize, smax, b);
+    });
+}
+
+void brightness(const ImageView& src, const MutableImageView& dst, int value) {
+    if (value < -255 || value > 255) throw invalid_argument("imageproc: brightness must be in [-255, 255]");
+    map_levels(src, dst, [&](const CImg<unsigned char>& in) { return op_brightness(in, value); });
+}
+
+void contrast(const ImageView& src, const MutableImageView& dst, float factor) {
+    if (!(factor >= 0.1f && factor <= 3.0f)) throw invalid_argument("imageproc: contrast factor must be in [0.1, 3.0]");
+    map_levels(src, dst, [&](const CImg<unsigned char>& in) { return op_contrast_linear(in, factor); });
+}
+
+void negative(const ImageView& src, const MutableImageView& dst) {
+    map_levels(src, dst, [](const CImg<unsigned char>& in) { return op_negative(in); });
+}
+
+void rgb_offset(const ImageView& src, const MutableImageView& dst, int add0, int add1, int add2) {
+    map_levels(src, dst, [&](const CImg<unsigned char>& in) {
+        return op_rgb_add(in, add0, add1, add2);
+    });
+}
+
+void flip_horizontal(const ImageView& src, const MutableImageView& dst) {
+    run_planar(src, dst, [](const CImg<unsigned char>& in, CImg<unsigned char>& out) {
+        op_hflip(in, out);
+    });
+}
+
+void flip_vertical(const ImageView& src, const MutableImageView& dst) {
+    run_planar(src, dst, [](const CImg<unsigned char>& in, CImg<unsigned char>& out) {
+        op_vflip(in, out);
+    });
+}
+
+void transpose(const ImageView& src, const MutableImageView& dst) {
+    check_view(src, "source");
+    check_view(dst, "destination");
+    if (dst.width != src.height || dst.height != src.width || dst.channels != src.channels) {
+        throw invalid_argument("imageproc: transpose needs a height x width destination");
+    }
+    convert_planar(src, dst, [](const CImg<unsigned char>& in, CImg<unsigned char>& out) {
+        op_dflip(in, out);
+    });
+}
+
+void resize_nearest(const ImageView& src, const MutableImageView& dst) {
+    check_view(src, "source");
+    check_view(dst, "destination");
+    if (dst.channels != src.channels) {
+        throw invalid_argument("imageproc: destination does not match the source");
+    }
+    convert_planar(src, dst, [&](const CImg<unsigned char>& in, CImg<unsigned char>& out) {
+        out = in.get_resize(dst.width, dst.height, 1, in.spectrum(), 1);  // 1: nearest neighbour
+    });
+}
+
+}  // namespace imageproc
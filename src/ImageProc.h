@@ -0,0 +1,140 @@
+#ifndef IMAGE_PROC_H
+#define IMAGE_PROC_H
+
+// Public API of libimageproc: the histogram, linear, non-linear and
+// smoothing filters and ImageProcessor's point and geometric ops over caller-owned 8-bit
+// buffers, for linking in-process instead of running the CLI.
+// Self-contained: no CImg and no internal headers.
+// Errors are reported as std::invalid_argument / std::runtime_error.
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__GNUC__)
+#define IMAGEPROC_API __attribute__((visibility("default")))
+#else
+#define IMAGEPROC_API
+#endif
+
+// Bumped on incompatible changes to anything in this header
+#define IMAGEPROC_API_VERSION 1
+
+namespace imageproc {
+
+// Pixel (x, y) of an interleaved buffer: channels bytes starting at
+// data + y * stride + x * channels (e.g. RGB, BGR or gray). Channels are
+// processed independently, so their order does not matter.
+struct ImageView {
+    const unsigned char* data;
+    int width, height, channels;
+    size_t stride;  // Bytes from one row to the next, >= width * channels
+};
+
+// Destination: must have the width, height and channels of the source
+// unless the function says otherwise. May alias the source buffer.
+struct MutableImageView {
+    unsigned char* data;
+    int width, height, channels;
+    size_t stride;
+
+    operator ImageView() const {
+        ImageView v = { data, width, height, channels, stride };
+        return v;
+    }
+};
+
+enum BorderMode {
+    BORDER_CLAMP,     // Repeat the edge pixel
+    BORDER_MIRROR,    // Reflect about the edge pixel
+    BORDER_WRAP,      // Tile periodically
+    BORDER_CONSTANT,  // borderValue outside the image
+    BORDER_COPY,      // Frame pixels keep their source value
+    BORDER_DEFAULT    // Each filter's own default (as on the command line)
+};
+
+enum RosenfeldDirection {
+    ROSENFELD_HORIZONTAL,
+    ROSENFELD_VERTICAL,
+    ROSENFELD_BOTH
+};
+
+// C1-C6 of one channel
+struct Characteristics {
+    double mean, variance;
+    double stdev, varcoeff_I;
+    double asymmetry, flattening;
+    double varcoeff_II, entropy;
+};
+
+IMAGEPROC_API int api_version();
+
+// Worker threads for all calls (default: hardware concurrency)
+IMAGEPROC_API void set_thread_count(int threads);
+
+// 256 bins per channel, channel-major: hist[c * 256 + v]
+IMAGEPROC_API void histograms(const ImageView& src, uint64_t* hist);
+
+IMAGEPROC_API Characteristics characteristics(const ImageView& src, int channel);
+
+// H4 power 2/3 equalization, per channel
+IMAGEPROC_API void histogram_power23(const ImageView& src, const MutableImageView& dst,
+                                     int gmin = 0, int gmax = 255);
+
+// S2 edge sharpening: variant 1-3, or 0 for the optimized version
+IMAGEPROC_API void edge_sharpen(const ImageView& src, const MutableImageView& dst,
+                                int variant, BorderMode border = BORDER_DEFAULT,
+                                int borderValue = 0);
+
+// Any size x size mask, row-major
+IMAGEPROC_API void convolve(const ImageView& src, const MutableImageView& dst,
+                            const float* kernel, int size,
+                            BorderMode border = BORDER_DEFAULT, int borderValue = 0);
+
+// O5 Rosenfeld operator
+IMAGEPROC_API void rosenfeld(const ImageView& src, const MutableImageView& dst, int P,
+                             RosenfeldDirection direction = ROSENFELD_HORIZONTAL,
+                             BorderMode border = BORDER_DEFAULT, int borderValue = 0);
+
+// Mean of the kernelSize x kernelSize window (odd, >= 3), rounded
+IMAGEPROC_API void arithmetic_mean(const ImageView& src, const MutableImageView& dst,
+                                   int kernelSize, BorderMode border = BORDER_DEFAULT,
+                                   int borderValue = 0);
+
+// Gaussian blur from three box passes per direction, 0 < sigma <= 1000
+IMAGEPROC_API void gaussian_blur(const ImageView& src, const MutableImageView& dst, float sigma,
+                                 BorderMode border = BORDER_DEFAULT, int borderValue = 0);
+
+// Median of the kernelSize x kernelSize window (odd, 3-255)
+IMAGEPROC_API void median(const ImageView& src, const MutableImageView& dst, int kernelSize,
+                          BorderMode border = BORDER_DEFAULT, int borderValue = 0);
+
+// Adaptive median: the window grows from kernelSize up to smax while its
+// median is an impulse (both odd, 3 <= kernelSize <= smax <= 255)
+IMAGEPROC_API void adaptive_median(const ImageView& src, const MutableImageView& dst,
+                                   int kernelSize, int smax,
+                                   BorderMode border = BORDER_DEFAULT, int borderValue = 0);
+
+// ImageProcessor's point ops, clamped to [0, 255]: v + value
+// (-255..255), (v - 128) * factor + 128 (0.1..3.0), 255 - v, and v plus
+// add0/add1/add2 on channels 0/1/2 (R, G, B of an RGB buffer)
+IMAGEPROC_API void brightness(const ImageView& src, const MutableImageView& dst, int value);
+IMAGEPROC_API void contrast(const ImageView& src, const MutableImageView& dst, float factor);
+IMAGEPROC_API void negative(const ImageView& src, const MutableImageView& dst);
+IMAGEPROC_API void rgb_offset(const ImageView& src, const MutableImageView& dst,
+                              int add0, int add1, int add2);
+
+// Mirror left/right and top/bottom
+IMAGEPROC_API void flip_horizontal(const ImageView& src, const MutableImageView& dst);
+IMAGEPROC_API void flip_vertical(const ImageView& src, const MutableImageView& dst);
+
+// Diagonal flip: dst is height x width
+IMAGEPROC_API void transpose(const ImageView& src, const MutableImageView& dst);
+
+// Nearest-neighbour resize to dst's width and height (same channels).
+// ImageProcessor's shrink/enlarge by f give max(1, round(width * f)) x
+// max(1, round(height * f)).
+IMAGEPROC_API void resize_nearest(const ImageView& src, const MutableImageView& dst);
+
+}  // namespace imageproc
+
+#endif
@@ -2,12 +2,23 @@
 #include "Operations.h"
 #include "Geometric.h"
 #include "NoiseFilters.h"
+#include "MappedBmp.h"
+#include "Histogram.h"
+#include "LinearFilters.h"
+#include "NonLinearFilters.h"
+#include "Parallel.h"
+#include "SimdKernels.h"
 #include <iostream>
-#include <fstream>
+#include <sys/stat.h>
 
 using namespace std;
 using namespace cimg_library;
 
+static uint64_t file_size(const string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? (uint64_t)st.st_size : 0;
+}
+
 ImageProcessor::ImageProcessor() : imageLoaded(false) {}
 
 ImageProcessor::~ImageProcessor() {}
@@ -15,22 +26,14 @@ ImageProcessor::~ImageProcessor() {}
 bool ImageProcessor::loadImage(const string& path) {
     try {
         string absPath = resolveAbsolutePath(path);
-        ifstream testFile(absPath.c_str(), ios::binary);
-        if (!testFile.good()) {
-            cerr << "[ImageProcessor] File not found: " << absPath << endl;
-            return false;
-        }
-        testFile.close();
         
-        FILE* file = fopen(absPath.c_str(), "rb");
-        if (!file) {
-            cerr << "[ImageProcessor] Cannot open file: " << absPath << endl;
-            return false;
+        // Single open: uncompressed 8/24-bit BMPs are memory-mapped and
+        // de-interleaved in place, anything else goes through CImg
+        {
+            ProfileScope scope("decode", &timings);
+            load_image(absPath, image);
+            scope.counts(file_size(absPath), image.size(), (uint64_t)image.width() * image.height());
         }
-        fclose(file);
-        
-        image.assign();
-        image.load_bmp(absPath.c_str());
         
         inputPath = path;
         imageLoaded = true;
@@ -55,7 +58,9 @@ bool ImageProcessor::saveImage(const string& path) {
         return false;
     }
     try {
+        ProfileScope scope("encode", &timings);
         saveAsBMP(image, path);
+        scope.counts(image.size(), file_size(path), (uint64_t)image.width() * image.height());
         outputPath = path;
         cout << "[ImageProcessor] Saved to: " << path << endl;
         return true;
@@ -82,63 +87,112 @@ void ImageProcessor::setImage(const CImg<unsigned char>& img) {
     imageLoaded = true;
 }
 
+void ImageProcessor::setImage(CImg<unsigned char>&& img) {
+    image.swap(img);
+    img.assign();
+    imageLoaded = true;
+}
+
+CImg<unsigned char> ImageProcessor::takeImage() {
+    if (!imageLoaded) throw runtime_error("No image loaded");
+    CImg<unsigned char> out;
+    out.swap(image);
+    imageLoaded = false;
+    return out;
+}
+
+void ImageProcessor::applyPointOp(
+        const function<CImg<unsigned char>(const CImg<unsigned char>&)>& op) {
+    int w = image.width(), h = image.height(), s = image.spectrum();
+    if (ramp.spectrum() != s) {
+        ramp.assign(256, 1, 1, s);
+        cimg_forXC(ramp, x, c) ramp(x, 0, 0, c) = (unsigned char)x;
+    }
+    const CImg<unsigned char> luts = op(ramp);
+    if (luts.width() != 256 || luts.height() != 1 || luts.spectrum() != s) {
+        throw runtime_error("Point op changed the image size");
+    }
+    parallel_for_rows(s, h, [&](int c, int y0, int y1) {
+        unsigned char* p = image.data(0, y0, 0, c);
+        apply_lut_u8(p, p, (size_t)(y1 - y0) * w, luts.data(0, 0, 0, c));
+    });
+}
+
+void ImageProcessor::applyIntoScratch(
+        const function<void(const CImg<unsigned char>&, CImg<unsigned char>&)>& op) {
+    op(image, scratch);
+    image.swap(scratch);
+}
+
 void ImageProcessor::applyBrightness(int value) {
     if (!imageLoaded) throw runtime_error("No image loaded");
     if (value < -255 || value > 255) throw runtime_error("Brightness value must be in [-255, 255]");
     cout << "[ImageProcessor] Applying brightness: " << value << endl;
-    image = op_brightness(image, value);
+    timed("brightness", [&] {
+        applyPointOp([&](const CImg<unsigned char>& in) { return op_brightness(in, value); });
+    });
 }
 
 void ImageProcessor::applyContrast(float factor) {
     if (!imageLoaded) throw runtime_error("No image loaded");
     if (factor < 0.1f || factor > 3.0f) throw runtime_error("Contrast factor must be in [0.1, 3.0]");
     cout << "[ImageProcessor] Applying contrast: " << factor << endl;
-    image = op_contrast_linear(image, factor);
+    timed("contrast", [&] {
+        applyPointOp([&](const CImg<unsigned char>& in) { return op_contrast_linear(in, factor); });
+    });
 }
 
 void ImageProcessor::applyNegative() {
     if (!imageLoaded) throw runtime_error("No image loaded");
     cout << "[ImageProcessor] Applying negative filter" << endl;
-    image = op_negative(image);
+    timed("negative", [&] {
+        applyPointOp([](const CImg<unsigned char>& in) { return op_negative(in); });
+    });
 }
 
 void ImageProcessor::applyRGBOffset(int rAdd, int gAdd, int bAdd) {
     if (!imageLoaded) throw runtime_error("No image loaded");
     cout << "[ImageProcessor] Applying RGB offset: R=" << rAdd 
          << ", G=" << gAdd << ", B=" << bAdd << endl;
-    image = op_rgb_add(image, rAdd, gAdd, bAdd);
+    timed("rgb_offset", [&] {
+        applyPointOp([&](const CImg<unsigned char>& in) { return op_rgb_add(in, rAdd, gAdd, bAdd); });
+    });
 }
 
 void ImageProcessor::applyHorizontalFlip() {
     if (!imageLoaded) throw runtime_error("No image loaded");
     cout << "[ImageProcessor] Applying horizontal flip" << endl;
-    image = op_hflip(image);
+    timed("hflip", [&] { op_hflip(image, image); });  // In place
 }
 
 void ImageProcessor::applyVerticalFlip() {
     if (!imageLoaded) throw runtime_error("No image loaded");
     cout << "[ImageProcessor] Applying vertical flip" << endl;
-    image = op_vflip(image);
+    timed("vflip", [&] { op_vflip(image, image); });  // In place
 }
 
 void ImageProcessor::applyDiagonalFlip() {
     if (!imageLoaded) throw runtime_error("No image loaded");
     cout << "[ImageProcessor] Applying diagonal flip (transpose)" << endl;
-    image = op_dflip(image);
+    timed("dflip", [&] {
+        applyIntoScratch([](const CImg<unsigned char>& in, CImg<unsigned char>& out) {
+            op_dflip(in, out);
+        });
+    });
 }
 
 void ImageProcessor::applyShrink(float factor) {
     if (!imageLoaded) throw runtime_error("No image loaded");
     if (factor <= 0.0f || factor >= 1.0f) throw runtime_error("Shrink factor must be in (0, 1)");
     cout << "[ImageProcessor] Shrinking image by factor: " << factor << endl;
-    image = op_shrink(image, factor);
+    timed("shrink", [&] { image = op_shrink(image, factor); });
 }
 
 void ImageProcessor::applyEnlarge(float factor) {
     if (!imageLoaded) throw runtime_error("No image loaded");
     if (factor <= 1.0f) throw runtime_error("Enlarge factor must be > 1.0");
     cout << "[ImageProcessor] Enlarging image by factor: " << factor << endl;
-    image = op_enlarge(image, factor);
+    timed("enlarge", [&] { image = op_enlarge(image, factor); });
 }
 
 void ImageProcessor::applyArithmeticMean(int kernelSize) {
@@ -146,7 +200,33 @@ void ImageProcessor::applyArithmeticMean(int kernelSize) {
     if (!isOdd(kernelSize) || kernelSize < 3) 
         throw runtime_error("Kernel size must be odd and >= 3");
     cout << "[ImageProcessor] Applying arithmetic mean filter, kernel=" << kernelSize << endl;
-    image = op_amean(image, kernelSize);
+    timed("amean", [&] {
+        applyIntoScratch([&](const CImg<unsigned char>& in, CImg<unsigned char>& out) {
+            box_filter(in, out, kernelSize / 2, kernelSize / 2);
+        });
+    });
+}
+
+void ImageProcessor::applyGaussianBlur(float sigma) {
+    if (!imageLoaded) throw runtime_error("No image loaded");
+    cout << "[ImageProcessor] Applying Gaussian blur, sigma=" << sigma << endl;
+    timed("gaussian", [&] {
+        applyIntoScratch([&](const CImg<unsigned char>& in, CImg<unsigned char>& out) {
+            gaussian_blur(in, out, sigma);
+        });
+    });
+}
+
+void ImageProcessor::applyMedian(int kernelSize) {
+    if (!imageLoaded) throw runtime_error("No image loaded");
+    if (!isOdd(kernelSize) || kernelSize < 3)
+        throw runtime_error("Kernel size must be odd and >= 3");
+    cout << "[ImageProcessor] Applying median filter, kernel=" << kernelSize << endl;
+    timed("median", [&] {
+        applyIntoScratch([&](const CImg<unsigned char>& in, CImg<unsigned char>& out) {
+            median_filter(in, out, kernelSize / 2);
+        });
+    });
 }
 
 void ImageProcessor::applyAdaptiveMedian(int kernelSize, int smax) {
@@ -157,5 +237,40 @@ void ImageProcessor::applyAdaptiveMedian(int kernelSize, int smax) {
         throw runtime_error("Smax must be odd and >= kernel size");
     cout << "[ImageProcessor] Applying adaptive median filter, kernel=" 
          << kernelSize << ", smax=" << smax << endl;
-    image = op_adaptive_median(image, kernelSize, smax);
+    timed("adaptive_median", [&] {
+        applyIntoScratch([&](const CImg<unsigned char>& in, CImg<unsigned char>& out) {
+            adaptive_median(in, out, kernelSize, smax);
+        });
+    });
+}
+
+void ImageProcessor::applyHistogramPower(int gmin, int gmax) {
+    if (!imageLoaded) throw runtime_error("No image loaded");
+    cout << "[ImageProcessor] Applying power 2/3 histogram equalization" << endl;
+    timed("hpower", [&] { histogram_power23(image, image, gmin, gmax); });  // In place: a point op
+}
+
+void ImageProcessor::applyEdgeSharpen(int variant) {
+    if (!imageLoaded) throw runtime_error("No image loaded");
+    if (variant < 0 || variant > 3) throw runtime_error("Variant must be 0 (optimized), 1, 2 or 3");
+    cout << "[ImageProcessor] Applying edge sharpening, variant=" << variant << endl;
+    timed("sedgesharp", [&] {
+        applyIntoScratch([&](const CImg<unsigned char>& in, CImg<unsigned char>& out) {
+            if (variant == 0) edge_sharpen_optimized(in, out);
+            else if (variant == 1) edge_sharpen_type1(in, out);
+            else if (variant == 2) edge_sharpen_type2(in, out);
+            else edge_sharpen_type3(in, out);
+        });
+    });
+}
+
+void ImageProcessor::applyRosenfeld(int P) {
+    if (!imageLoaded) throw runtime_error("No image loaded");
+    if (P < 1) throw runtime_error("Rosenfeld P must be >= 1");
+    cout << "[ImageProcessor] Applying Rosenfeld operator, P=" << P << endl;
+    timed("orosenfeld", [&] {
+        applyIntoScratch([&](const CImg<unsigned char>& in, CImg<unsigned char>& out) {
+            rosenfeld_operator(in, out, P);
+        });
+    });
 }
@@ -2,6 +2,8 @@
 #define IMAGE_PROCESSOR_H
 
 #include "Utils.h"
+#include "Profile.h"
+#include <functional>
 #include <string>
 
 using namespace cimg_library;
@@ -10,9 +12,30 @@ using namespace std;
 class ImageProcessor {
 private:
     CImg<unsigned char> image;
+    CImg<unsigned char> scratch;  // Output buffer of the next op, swapped with image
+    CImg<unsigned char> ramp;     // Every channel 0..255: input for point-op tables
     string inputPath;
     string outputPath;
     bool imageLoaded;
+    vector<ProfileRecord> timings;
+
+    // Remap image in place through the per-channel tables op yields on ramp
+    // (op must map each value of each channel independently)
+    void applyPointOp(const function<CImg<unsigned char>(const CImg<unsigned char>&)>& op);
+
+    // op(image, scratch), then swap: once the buffers have the image size,
+    // ops allocate nothing
+    void applyIntoScratch(
+        const function<void(const CImg<unsigned char>&, CImg<unsigned char>&)>& op);
+
+    // Run op as one stage of timings, counting the image before and after
+    template <typename Fn>
+    void timed(const char* stage, Fn op) {
+        ProfileScope scope(stage, &timings);
+        uint64_t bytesIn = image.size();
+        op();
+        scope.counts(bytesIn, image.size(), (uint64_t)image.width() * image.height());
+    }
 
 public:
     ImageProcessor();
@@ -34,15 +57,32 @@ public:
     void applyHorizontalFlip();
     void applyVerticalFlip();
     void applyDiagonalFlip();
+    // Shrink and enlarge change the image size, so each call allocates its
+    // output; the other ops reuse image and scratch once they have the size
     void applyShrink(float factor);
     void applyEnlarge(float factor);
 
     void applyArithmeticMean(int kernelSize);
+    void applyGaussianBlur(float sigma);
+    void applyMedian(int kernelSize);
     void applyAdaptiveMedian(int kernelSize, int smax);
 
+    void applyHistogramPower(int gmin, int gmax);
+    void applyEdgeSharpen(int variant);  // 1-3, or 0 for the optimized version
+    void applyRosenfeld(int P);
+
     const CImg<unsigned char>& getImage() const { return image; }
+    // Move the image out without copying; the processor is then empty
+    CImg<unsigned char> takeImage();
     
     void setImage(const CImg<unsigned char>& img);
+    // Adopt img's buffer without copying; img is left empty
+    void setImage(CImg<unsigned char>&& img);
+
+    // Wall/CPU time, bytes and pixels of every load, op and save since
+    // construction or the last resetTimings(), as -profile reports them
+    const vector<ProfileRecord>& getTimings() const { return timings; }
+    void resetTimings() { timings.clear(); }
 };
 
 #endif
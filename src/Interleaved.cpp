@@ -0,0 +1,154 @@
+#include "Interleaved.h"
+#include "BmpStream.h"
+#include "LinearFilters.h"
+#include "Parallel.h"
+#include "Profile.h"
+#include "SimdKernels.h"
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+// Output in BMP file layout: rows bottom-up, each padded to stride bytes
+struct BgrOutput {
+    vector<unsigned char> data;
+    size_t stride;
+    int width, height;
+
+    BgrOutput(int w, int h)
+        : stride((3 * (size_t)w + 3) & ~(size_t)3), width(w), height(h) {
+        data.resize(stride * h);  // Zeroed, which also clears the row padding
+    }
+
+    unsigned char* row(int y) { return data.data() + stride * (height - 1 - y); }
+};
+
+// Channel c of pixel (x, y) resolved through the border mode
+static inline int fetch(const MappedBmp& src, int x, int y, int c, const Border& border) {
+    int bx = border_index(x, src.width(), border.mode);
+    int by = border_index(y, src.height(), border.mode);
+    if (bx < 0 || by < 0) return border.value;
+    return src.row(by)[3 * bx + c];
+}
+
+static void convolve3x3_bgr(const MappedBmp& src, BgrOutput& out, const short k[9],
+                            const Border& border) {
+    int w = src.width(), h = src.height();
+
+    parallel_for_rows(1, h, [&](int, int y0, int y1) {
+        // Interior: one call per row covers all three channels
+        for (int y = max(y0, 1); y < min(y1, h - 1) && w > 2; ++y) {
+            conv3x3_row_u8(src.row(y - 1) + 3, src.row(y) + 3, src.row(y + 1) + 3,
+                           out.row(y) + 3, 3 * (w - 2), k, 3);
+        }
+        for_each_frame_pixel(w, h, 1, 1, y0, y1, [&](int x, int y) {
+            unsigned char* d = out.row(y) + 3 * x;
+            for (int c = 0; c < 3; ++c) {
+                if (border.mode == BORDER_COPY) {
+                    d[c] = src.row(y)[3 * x + c];
+                    continue;
+                }
+                int sum = 0;
+                for (int t = 0; t < 9; ++t) {
+                    sum += k[t] * fetch(src, x + t % 3 - 1, y + t / 3 - 1, c, border);
+                }
+                d[c] = (unsigned char)clampv(sum, 0, 255);
+            }
+        });
+    });
+}
+
+static void edge_sharpen_optimized_bgr(const MappedBmp& src, BgrOutput& out,
+                                       const Border& border) {
+    int w = src.width(), h = src.height();
+
+    parallel_for_rows(1, h, [&](int, int y0, int y1) {
+        // Interior: bytes of all channels in one loop, neighbours 3 apart
+        for (int y = max(y0, 1); y < min(y1, h - 1); ++y) {
+            const unsigned char* p = src.row(y);
+            const unsigned char* up = src.row(y - 1);
+            const unsigned char* down = src.row(y + 1);
+            unsigned char* d = out.row(y);
+            for (int i = 3; i < 3 * (w - 1); ++i) {
+                int original = p[i];
+                int avg = (p[i - 3] + p[i + 3] + up[i] + down[i]) / 4;
+                d[i] = (unsigned char)clampv(original + (original - avg), 0, 255);
+            }
+        }
+        for_each_frame_pixel(w, h, 1, 1, y0, y1, [&](int x, int y) {
+            unsigned char* d = out.row(y) + 3 * x;
+            for (int c = 0; c < 3; ++c) {
+                int original = src.row(y)[3 * x + c];
+                if (border.mode == BORDER_COPY) {
+                    d[c] = (unsigned char)original;
+                    continue;
+                }
+                int sum = fetch(src, x - 1, y, c, border) + fetch(src, x + 1, y, c, border) +
+                          fetch(src, x, y - 1, c, border) + fetch(src, x, y + 1, c, border);
+                d[c] = (unsigned char)clampv(original + (original - sum / 4), 0, 255);
+            }
+        });
+    });
+}
+
+static void histogram_power23_bgr(const MappedBmp& src, BgrOutput& out, int gmin, int gmax) {
+    int w = src.width();
+    auto luts = power23_luts(src.histograms(), gmin, gmax);  // R, G, B
+    const unsigned char* bgr[3] = { luts[2].data(), luts[1].data(), luts[0].data() };
+
+    parallel_for_rows(1, src.height(), [&](int, int y0, int y1) {
+        for (int y = y0; y < y1; ++y) apply_lut3_u8(src.row(y), out.row(y), 3 * (size_t)w, bgr);
+    });
+}
+
+bool interleaved_supports(const CommandOptions& opts, const MappedBmp& bmp) {
+    if (!opts.interleaved || bmp.bpp() != 24) return false;
+    if (opts.command == "--hpower") return true;
+    return opts.command == "--sedgesharp" &&
+           (opts.optimized || (opts.variant >= 1 && opts.variant <= 3));
+}
+
+// The command itself, from the mapped rows into out
+static void interleaved_op(const CommandOptions& opts, const MappedBmp& bmp, BgrOutput& out,
+                           ostream& log) {
+    if (opts.command == "--hpower") {
+        histogram_power23_bgr(bmp, out, opts.gmin, opts.gmax);
+        log << "Applied power 2/3 histogram equalization\n";
+    }
+    else if (opts.command == "--sedgesharp" && opts.optimized) {
+        edge_sharpen_optimized_bgr(bmp, out, opts.borderSet ? opts.border : Border(BORDER_CLAMP));
+        log << "Applied optimized edge sharpening\n";
+    }
+    else if (opts.command == "--sedgesharp" && opts.variant >= 1 && opts.variant <= 3) {
+        convolve3x3_bgr(bmp, out, edge_sharpen_mask(opts.variant),
+                        opts.borderSet ? opts.border : Border(BORDER_COPY));
+        log << "Applied edge sharpening (variant " << opts.variant << ")\n";
+    }
+    else {
+        throw runtime_error("No interleaved path for " + opts.command);
+    }
+}
+
+void run_interleaved(const CommandOptions& opts, const MappedBmp& bmp,
+                     const string& outputPath, ostream& log) {
+    int w = bmp.width(), h = bmp.height();
+    BgrOutput out(w, h);
+    uint64_t pixels = (uint64_t)w * h;
+    {
+        ProfileScope scope(command_stage_name(opts.command) + " (interleaved)");
+        interleaved_op(opts, bmp, out, log);
+        scope.counts(bmp.stride() * h, out.data.size(), pixels);
+    }
+
+    ProfileScope encode("encode");
+    unsigned char header[54];
+    bmp24_header(header, w, h);
+    FILE* file = fopen(outputPath.c_str(), "wb");
+    if (!file) throw runtime_error("Cannot create " + outputPath);
+    bool ok = fwrite(header, 1, 54, file) == 54 &&
+              fwrite(out.data.data(), 1, out.data.size(), file) == out.data.size();
+    if (fclose(file) != 0 || !ok) throw runtime_error("Cannot write " + outputPath);
+    encode.counts(out.data.size(), 54 + out.data.size(), pixels);
+}
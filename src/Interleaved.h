@@ -0,0 +1,22 @@
+#ifndef INTERLEAVED_H
+#define INTERLEAVED_H
+
+#include "Commands.h"
+#include "MappedBmp.h"
+#include <ostream>
+#include <string>
+
+// Colour commands run directly on interleaved BGR rows: the mapped rows
+// of a 24-bit BMP go in and BMP file rows come out, with no planar image
+// in between. The SIMD row kernels use a pixel step of 3, so every vector
+// covers B, G and R at once. Output is byte-identical to the planar path.
+
+// True if opts.command has an interleaved implementation for bmp:
+// --hpower and --sedgesharp on 24-bit files, unless -planar is given
+bool interleaved_supports(const CommandOptions& opts, const MappedBmp& bmp);
+
+// Run it and save the result as a 24-bit BMP to outputPath
+void run_interleaved(const CommandOptions& opts, const MappedBmp& bmp,
+                     const std::string& outputPath, std::ostream& log);
+
+#endif
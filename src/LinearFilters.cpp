@@ -1,85 +1,569 @@
 #include "LinearFilters.h"
+#include "Fft.h"
+#include "Parallel.h"
+#include "SimdKernels.h"
 #include <iostream>
+#include <stdexcept>
 
 using namespace std;
+using convolve_detail::LocalTaps;
+using convolve_detail::convolve_plane_frame;
+using convolve_detail::convolve_plane_unrolled;
+using convolve_detail::to_pixel;
 
-CImg<unsigned char> convolve_universal(const CImg<unsigned char>& src,
-                                       const vector<vector<float>>& kernel) {
-    int w = src.width(), h = src.height(), s = src.spectrum();
-    int M = kernel.size() / 2;  // Assuming square kernel
-    CImg<unsigned char> out(w, h, 1, s);
+bool kernel_separable(const vector<vector<float>>& kernel,
+                      vector<float>& col, vector<float>& row) {
+    int n = kernel.size();
+    if (n == 0) return false;
     
-    for (int c = 0; c < s; ++c) {
-        cimg_forXY(src, x, y) {
-            // Skip borders - just copy original
-            if (x < M || y < M || x >= w - M || y >= h - M) {
-                out(x, y, c) = src(x, y, c);
-                continue;
+    // Pivot on the largest coefficient: K = col * row^T with row = K[pi] / K[pi][pj]
+    int pi = 0, pj = 0;
+    float peak = 0.0f;
+    for (int i = 0; i < n; ++i) {
+        if ((int)kernel[i].size() != n) return false;
+        for (int j = 0; j < n; ++j) {
+            if (fabs(kernel[i][j]) > peak) {
+                peak = fabs(kernel[i][j]);
+                pi = i; pj = j;
+            }
+        }
+    }
+    
+    col.assign(n, 0.0f);
+    row.assign(n, 0.0f);
+    if (peak == 0.0f) return true;  // All-zero kernel is trivially rank 1
+    
+    for (int i = 0; i < n; ++i) col[i] = kernel[i][pj];
+    for (int j = 0; j < n; ++j) row[j] = kernel[pi][j] / kernel[pi][pj];
+    
+    // Verify rank 1 within float tolerance relative to the largest tap
+    const float tol = 1e-5f * peak;
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            if (fabs(col[i] * row[j] - kernel[i][j]) > tol) return false;
+        }
+    }
+    return true;
+}
+
+bool kernel_fixed_point(const vector<vector<float>>& kernel, vector<int>& taps, int& shift) {
+    int n = kernel.size();
+    if (n == 0) return false;
+    for (int i = 0; i < n; ++i) {
+        if ((int)kernel[i].size() != n) return false;
+    }
+    
+    // Smallest shift that makes every tap an integer
+    for (shift = 0; shift <= FIXED_POINT_MAX_SHIFT; ++shift) {
+        float scale = ldexp(1.0f, shift);  // Power of two: scaling is exact
+        bool integral = true;
+        for (int i = 0; i < n && integral; ++i) {
+            for (int j = 0; j < n && integral; ++j) {
+                float v = kernel[i][j] * scale;
+                integral = v == floor(v) && fabs(v) < (1 << 24);
             }
+        }
+        if (integral) break;
+    }
+    if (shift > FIXED_POINT_MAX_SHIFT) return false;
+    
+    float scale = ldexp(1.0f, shift);
+    long long total = 0;
+    taps.resize(n * n);
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            taps[i * n + j] = (int)(kernel[i][j] * scale);
+            total += abs(taps[i * n + j]);
+        }
+    }
+    return 255 * total < (1 << 24);
+}
+
+// Integer rank-1 split of fixed-point taps: taps == col * row^T exactly.
+// row is the pivot row divided by its gcd, so col comes out integral.
+static bool fixed_separable(const vector<int>& taps, int n, vector<int>& col, vector<int>& row) {
+    int pi = 0, pj = 0, peak = 0;
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            if (abs(taps[i * n + j]) > peak) {
+                peak = abs(taps[i * n + j]);
+                pi = i; pj = j;
+            }
+        }
+    }
+    if (peak == 0) return false;  // All-zero mask: the dense path is as cheap
+    
+    int g = 0;
+    for (int j = 0; j < n; ++j) {
+        for (int a = g, b = abs(taps[pi * n + j]); ; ) {  // g = gcd(g, |tap|)
+            if (b == 0) { g = a; break; }
+            int r = a % b; a = b; b = r;
+        }
+    }
+    row.resize(n);
+    col.resize(n);
+    for (int j = 0; j < n; ++j) row[j] = taps[pi * n + j] / g;
+    for (int i = 0; i < n; ++i) {
+        if (taps[i * n + pj] % row[pj] != 0) return false;
+        col[i] = taps[i * n + pj] / row[pj];
+    }
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            if ((long long)col[i] * row[j] != taps[i * n + j]) return false;
+        }
+    }
+    return true;
+}
+
+// Separable path: vertical taps into one row of T, then horizontal taps.
+// 2n taps per pixel instead of n*n, and only a single row of scratch.
+// T is float, or int for fixed-point taps with shift fraction bits. With
+// float taps the sums are not bit-identical to the dense (i, j) order.
+template <typename T>
+static void convolve_plane_separable(const unsigned char* src, unsigned char* dst,
+                                     int w, int h, const vector<T>& col,
+                                     const vector<T>& row, int shift, int y0, int y1) {
+    int n = col.size(), M = n / 2;
+    vector<T> vrow(w);
+    
+    for (int y = max(y0, M); y < min(y1, h - M); ++y) {
+        fill(vrow.begin(), vrow.end(), T(0));
+        for (int i = 0; i < n; ++i) {
+            const unsigned char* s = src + (size_t)(y - M + i) * w;
+            T k = col[i];
+            for (int x = 0; x < w; ++x) vrow[x] += k * s[x];
+        }
+        
+        unsigned char* d = dst + (size_t)y * w;
+        for (int x = M; x < w - M; ++x) {
+            const T* v = &vrow[x - M];
+            T sum = 0;
+            for (int j = 0; j < n; ++j) sum += row[j] * v[j];
+            d[x] = to_pixel(sum, shift);
+        }
+    }
+}
+
+// General path: flattened kernel, taps applied to whole row blocks so the
+// inner loop is a contiguous multiply-add the compiler can vectorize.
+// Per-pixel summation order matches the naive (i, j) loop.
+static void convolve_plane_blocked(const unsigned char* src, unsigned char* dst,
+                                   int w, int h, const vector<float>& flat, int n,
+                                   int y0, int y1) {
+    const int BLOCK = 512;
+    int M = n / 2;
+    vector<float> acc(BLOCK);
+    
+    for (int y = max(y0, M); y < min(y1, h - M); ++y) {
+        unsigned char* d = dst + (size_t)y * w;
+        for (int x0 = M; x0 < w - M; x0 += BLOCK) {
+            int len = min(BLOCK, w - M - x0);
+            fill(acc.begin(), acc.begin() + len, 0.0f);
             
-            // Apply convolution
-            float sum = 0.0f;
-            for (int i = -M; i <= M; ++i) {
-                for (int j = -M; j <= M; ++j) {
-                    sum += kernel[i + M][j + M] * src(x + j, y + i, c);
+            const float* k = flat.data();
+            for (int i = 0; i < n; ++i) {
+                const unsigned char* s = src + (size_t)(y - M + i) * w + x0 - M;
+                for (int j = 0; j < n; ++j, ++k) {
+                    float kv = *k;
+                    const unsigned char* sj = s + j;
+                    for (int x = 0; x < len; ++x) acc[x] += kv * sj[x];
                 }
             }
             
-            out(x, y, c) = (unsigned char)clampv((int)round(sum), 0, 255);
+            for (int x = 0; x < len; ++x) {
+                d[x0 + x] = (unsigned char)clampv((int)round(acc[x]), 0, 255);
+            }
+        }
+    }
+}
+
+// Non-separable masks: the common sizes get a specialization with the
+// tap loop unrolled at compile time, others the blocked loop
+static void convolve_plane_dense(const unsigned char* src, unsigned char* dst,
+                                 int w, int h, const vector<float>& flat, int n,
+                                 int y0, int y1) {
+    switch (n) {
+        case 3:
+            convolve_plane_unrolled<3, float>(src, dst, w, h, LocalTaps<3, float>(flat.data()), y0, y1);
+            break;
+        case 5:
+            convolve_plane_unrolled<5, float>(src, dst, w, h, LocalTaps<5, float>(flat.data()), y0, y1);
+            break;
+        case 7:
+            convolve_plane_unrolled<7, float>(src, dst, w, h, LocalTaps<7, float>(flat.data()), y0, y1);
+            break;
+        default:
+            convolve_plane_blocked(src, dst, w, h, flat, n, y0, y1);
+    }
+}
+
+// Whether convmxm_row_u8() can accumulate taps in 16 bits
+static bool fits_16bit(const vector<int>& taps, int shift) {
+    long long total = 0;
+    bool negative = false;
+    for (int t : taps) {
+        total += abs(t);
+        negative |= t < 0;
+    }
+    long long bound = 255 * total + ((1 << shift) >> 1);
+    return bound <= 32767 || (!negative && shift >= 1 && bound <= 65535);
+}
+
+// Cost model of convolve_universal(), in ns on one core (x86-64, -O2,
+// 1024x1024 plane); only the ratios matter
+static const double COST_PIXEL = 3.0;                // Overhead of a direct path, per pixel
+static const double COST_DENSE_TAP = 0.4;            // Unrolled float loop, per pixel and tap
+static const double COST_BLOCKED_TAP = 1.75;         // Blocked float loop
+static const double COST_SEPARABLE_TAP = 1.1;        // Float 1D passes (2n taps)
+static const double COST_FIXED_SEPARABLE_TAP = 1.0;  // int32 1D passes (2n taps)
+static const double COST_FIXED_TAP[] = { 0, 0.2, 0.11, 0.055 };  // int16 SIMD rows, by SimdLevel
+static const double COST_FFT_UNIT = 10.0;            // Per point and log2(F) of a block pair
+
+// Cost of the FFT path with F x F blocks over a w x h plane. Blocks that
+// outgrow L2 run slower per unit.
+static double fft_cost(int w, int h, int n, int F) {
+    int T = F - n + 1;
+    double blocks = (double)((w + T - 1) / T) * ((h + T - 1) / T);
+    double unit = COST_FFT_UNIT * (F <= 256 ? 1.0 : F <= 512 ? 1.2 : 1.4);
+    return blocks / 2 * unit * F * F * log2((double)F);
+}
+
+// Cheapest block size: big blocks waste less on the halo, but not past
+// the image
+static int fft_block_size(int w, int h, int n) {
+    int best = fft_size(2 * n);
+    int limit = max(best, fft_size(max(w, h) + n - 1));
+    for (int F = best * 2; F <= min(limit, FFT_MAX_BLOCK); F *= 2) {
+        if (fft_cost(w, h, n, F) < fft_cost(w, h, n, best)) best = F;
+    }
+    return best;
+}
+
+// FFT path, overlap-save: each F x F input block (an output tile plus the
+// kernel halo, outside pixels resolved through the border mode) is
+// transformed, multiplied by the kernel spectrum and transformed back; the
+// block's last F - n + 1 rows and columns are the tile's outputs. Two
+// blocks share a transform as its real and imaginary parts, which the real
+// kernel keeps apart. Tiles write disjoint outputs, so they run in
+// parallel. With shift >= 0 the mask is taps / 2^shift (kernel_fixed_point)
+// and every exact sum lies on the 2^-shift grid: results are snapped to it
+// before rounding, far within the transform's error, so they equal the
+// direct paths' even at .5. shift < 0 for other masks.
+static void convolve_fft_blocks(const CImg<unsigned char>& src, CImg<unsigned char>& out,
+                                const vector<float>& flat, int n, int F, const Border& border,
+                                int shift) {
+    typedef FftPlan::Complex Complex;
+    int w = src.width(), h = src.height(), s = src.spectrum();
+    int M = n / 2, T = F - n + 1;
+    double grid = shift >= 0 ? ldexp(1.0, shift) : 0;
+    FftPlan plan(F);
+    
+    // Kernel flipped into correlation order, with the inverse's 1 / F^2
+    vector<Complex> spectrum((size_t)F * F);
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            spectrum[(size_t)i * F + j] = flat[(n - 1 - i) * n + (n - 1 - j)] / ((double)F * F);
         }
     }
+    plan.transform2d(spectrum.data(), false);
+    
+    struct Block { int c, x0, y0; };
+    vector<Block> blocks;
+    for (int c = 0; c < s; ++c) {
+        for (int y0 = 0; y0 < h; y0 += T) {
+            for (int x0 = 0; x0 < w; x0 += T) blocks.push_back({ c, x0, y0 });
+        }
+    }
+    
+    parallel_for((blocks.size() + 1) / 2, [&](int task) {
+        const Block* pair[2] = { &blocks[2 * task],
+                                 2 * task + 1 < (int)blocks.size() ? &blocks[2 * task + 1] : nullptr };
+        vector<Complex> buf((size_t)F * F);
+        double* d = reinterpret_cast<double*>(buf.data());
+        vector<int> cols(F);
+        
+        for (int part = 0; part < 2 && pair[part]; ++part) {
+            const Block& b = *pair[part];
+            const unsigned char* sp = src.data(0, 0, 0, b.c);
+            for (int u = 0; u < F; ++u) cols[u] = border_index(b.x0 - M + u, w, border.mode);
+            for (int v = 0; v < F; ++v) {
+                int row = border_index(b.y0 - M + v, h, border.mode);
+                double* dv = d + 2 * (size_t)v * F + part;
+                for (int u = 0; u < F; ++u) {
+                    dv[2 * u] = row < 0 || cols[u] < 0 ? border.value
+                                                       : sp[(size_t)row * w + cols[u]];
+                }
+            }
+        }
+        
+        plan.transform2d(buf.data(), false);
+        const double* k = reinterpret_cast<const double*>(spectrum.data());
+        for (size_t i = 0; i < 2 * (size_t)F * F; i += 2) {
+            double re = d[i] * k[i] - d[i + 1] * k[i + 1];
+            double im = d[i] * k[i + 1] + d[i + 1] * k[i];
+            d[i] = re;
+            d[i + 1] = im;
+        }
+        plan.transform2d(buf.data(), true);
+        
+        for (int part = 0; part < 2 && pair[part]; ++part) {
+            const Block& b = *pair[part];
+            const unsigned char* sp = src.data(0, 0, 0, b.c);
+            unsigned char* dp = out.data(0, 0, 0, b.c);
+            for (int y = b.y0; y < min(b.y0 + T, h); ++y) {
+                const double* dv = d + 2 * ((size_t)(y - b.y0 + n - 1) * F + n - 1) + part;
+                bool frameRow = y < M || y >= h - M;
+                for (int x = b.x0; x < min(b.x0 + T, w); ++x) {
+                    size_t idx = (size_t)y * w + x;
+                    if (border.mode == BORDER_COPY && (frameRow || x < M || x >= w - M)) {
+                        dp[idx] = sp[idx];
+                        continue;
+                    }
+                    double v = dv[2 * (x - b.x0)];
+                    if (shift >= 0) v = floor(v * grid + 0.5) / grid;
+                    // floor(v + 0.5) is round() wherever the clamp keeps it
+                    dp[idx] = (unsigned char)clampv((int)floor(v + 0.5), 0, 255);
+                }
+            }
+        }
+    });
+}
+
+void convolve_fft(const CImg<unsigned char>& src, CImg<unsigned char>& out,
+                  const vector<vector<float>>& kernel, const Border& border) {
+    if (&out == &src) {
+        CImg<unsigned char> tmp;
+        convolve_fft(src, tmp, kernel, border);
+        out.swap(tmp);
+        return;
+    }
+    int n = kernel.size();
+    vector<float> flat;
+    for (int i = 0; i < n; ++i) {
+        if ((int)kernel[i].size() != n) throw runtime_error("Kernel must be square");
+        flat.insert(flat.end(), kernel[i].begin(), kernel[i].end());
+    }
+    vector<int> taps;
+    int shift;
+    if (!kernel_fixed_point(kernel, taps, shift)) shift = -1;
+    out.assign(src.width(), src.height(), 1, src.spectrum());
+    convolve_fft_blocks(src, out, flat, n, fft_block_size(src.width(), src.height(), n), border,
+                        shift);
+}
+
+// Paths of convolve_universal()
+enum ConvolvePath {
+    PATH_DENSE,             // Float taps, unrolled or blocked
+    PATH_SEPARABLE,         // Float 1D passes
+    PATH_FIXED,             // int16 SIMD rows (kernel_fixed_point)
+    PATH_FIXED_SEPARABLE,   // int32 1D passes (kernel_fixed_point)
+    PATH_FFT                // FFT blocks
+};
+
+struct ConvolvePlan {
+    ConvolvePath path;
+    int n;
+    vector<float> flat, col, row;    // Float taps, and the split if separable
+    vector<int> taps, icol, irow;    // Fixed-point taps, and the split if any
+    int shift;                       // -1 unless kernel_fixed_point()
+    int fftBlock;
+};
+
+// Cheapest path for kernel over w x h planes. For masks kernel_fixed_point()
+// represents exactly, every path (FFT included) gives the exact rounded sum.
+// For other masks the float paths round their sums differently: the
+// separable passes add column then row, the dense ones in (i, j) order and
+// FFT in its own, so results can differ by 1 where a sum lies near .5.
+static ConvolvePlan plan_convolution(int w, int h, const vector<vector<float>>& kernel) {
+    ConvolvePlan plan;
+    int n = plan.n = kernel.size();
+    for (int i = 0; i < n; ++i) {
+        plan.flat.insert(plan.flat.end(), kernel[i].begin(), kernel[i].end());
+    }
+    bool separable = kernel_separable(kernel, plan.col, plan.row);
+    double taps = (double)n * n;
+    
+    // Fixed-point int16 rows lose to the unrolled float loop at SIMD_SCALAR
+    SimdLevel level = simd_level();
+    bool fixed = kernel_fixed_point(kernel, plan.taps, plan.shift);
+    if (!fixed) plan.shift = -1;
+    if (fixed && level > SIMD_SCALAR && fits_16bit(plan.taps, plan.shift)) {
+        plan.path = PATH_FIXED;
+    } else if (fixed && fixed_separable(plan.taps, n, plan.icol, plan.irow)) {
+        plan.path = PATH_FIXED_SEPARABLE;
+    } else {
+        plan.path = separable ? PATH_SEPARABLE : PATH_DENSE;
+    }
+    
+    double tapCost;
+    switch (plan.path) {
+        case PATH_FIXED:           tapCost = taps * COST_FIXED_TAP[level]; break;
+        case PATH_FIXED_SEPARABLE: tapCost = 2 * n * COST_FIXED_SEPARABLE_TAP; break;
+        case PATH_SEPARABLE:       tapCost = 2 * n * COST_SEPARABLE_TAP; break;
+        default: tapCost = taps * (n <= 7 ? COST_DENSE_TAP : COST_BLOCKED_TAP);
+    }
+    double direct = (double)w * h * (COST_PIXEL + tapCost);
+    
+    plan.fftBlock = fft_block_size(w, h, n);
+    if (n > 1 && fft_cost(w, h, n, plan.fftBlock) < direct) plan.path = PATH_FFT;
+    return plan;
+}
+
+void convolve_universal(const CImg<unsigned char>& src, CImg<unsigned char>& out,
+                        const vector<vector<float>>& kernel, const Border& border) {
+    if (&out == &src) {
+        CImg<unsigned char> tmp;
+        convolve_universal(src, tmp, kernel, border);
+        out.swap(tmp);
+        return;
+    }
+    int w = src.width(), h = src.height(), s = src.spectrum();
+    out.assign(w, h, 1, s);
+    ConvolvePlan plan = plan_convolution(w, h, kernel);
+    int n = plan.n, M = n / 2;
+    if (plan.path == PATH_FFT) {
+        convolve_fft_blocks(src, out, plan.flat, n, plan.fftBlock, border, plan.shift);
+        return;
+    }
+    vector<short> taps16(plan.taps.begin(), plan.taps.end());
+    
+    parallel_for_rows(s, h, [&](int c, int y0, int y1) {
+        const unsigned char* sp = src.data(0, 0, 0, c);
+        unsigned char* dp = out.data(0, 0, 0, c);
+        vector<const unsigned char*> rows(n);
+        switch (plan.path) {
+            case PATH_FIXED:
+                for (int y = max(y0, M); y < min(y1, h - M) && w > 2 * M; ++y) {
+                    for (int i = 0; i < n; ++i) rows[i] = sp + (size_t)(y - M + i) * w;
+                    convmxm_row_u8(rows.data(), dp + (size_t)y * w + M, w - 2 * M,
+                                   taps16.data(), n, plan.shift);
+                }
+                break;
+            case PATH_FIXED_SEPARABLE:
+                convolve_plane_separable(sp, dp, w, h, plan.icol, plan.irow, plan.shift, y0, y1);
+                break;
+            case PATH_SEPARABLE:
+                convolve_plane_separable(sp, dp, w, h, plan.col, plan.row, 0, y0, y1);
+                break;
+            default:
+                convolve_plane_dense(sp, dp, w, h, plan.flat, n, y0, y1);
+        }
+        if (plan.path == PATH_FIXED || plan.path == PATH_FIXED_SEPARABLE) {
+            convolve_plane_frame(sp, dp, w, h, plan.taps.data(), n, border, y0, y1, plan.shift);
+        } else {
+            convolve_plane_frame(sp, dp, w, h, plan.flat.data(), n, border, y0, y1);
+        }
+    });
+}
+
+CImg<unsigned char> convolve_universal(const CImg<unsigned char>& src,
+                                       const vector<vector<float>>& kernel,
+                                       const Border& border) {
+    CImg<unsigned char> out;
+    convolve_universal(src, out, kernel, border);
     return out;
 }
 
-CImg<unsigned char> edge_sharpen_type1(const CImg<unsigned char>& src) {
-    // Kernel: center=5, cross=-1
-    vector<vector<float>> kernel = {
-        {0, -1, 0},
-        {-1, 5, -1},
-        {0, -1, 0}
-    };
-    return convolve_universal(src, kernel);
+constexpr short EdgeSharpenMask1::taps[9];
+constexpr short EdgeSharpenMask2::taps[9];
+constexpr short EdgeSharpenMask3::taps[9];
+
+const short* edge_sharpen_mask(int variant) {
+    switch (variant) {
+        case 1: return EdgeSharpenMask1::taps;
+        case 2: return EdgeSharpenMask2::taps;
+        case 3: return EdgeSharpenMask3::taps;
+        default: throw runtime_error("Variant must be 1, 2 or 3");
+    }
 }
 
-CImg<unsigned char> edge_sharpen_type2(const CImg<unsigned char>& src) {
-    // Kernel: center=9, all neighbors=-1
-    vector<vector<float>> kernel = {
-        {-1, -1, -1},
-        {-1,  9, -1},
-        {-1, -1, -1}
-    };
-    return convolve_universal(src, kernel);
+// Integer masks: the SIMD row kernel, or the unrolled loop at SIMD_SCALAR
+void edge_sharpen_type1(const CImg<unsigned char>& src, CImg<unsigned char>& out,
+                        const Border& border) {
+    convolve<EdgeSharpenMask1, int>(src, out, border);
 }
 
-CImg<unsigned char> edge_sharpen_type3(const CImg<unsigned char>& src) {
-    // Kernel: center=5, diagonal=1, cross=-2
-    vector<vector<float>> kernel = {
-        {1, -2, 1},
-        {-2, 5, -2},
-        {1, -2, 1}
-    };
-    return convolve_universal(src, kernel);
+void edge_sharpen_type2(const CImg<unsigned char>& src, CImg<unsigned char>& out,
+                        const Border& border) {
+    convolve<EdgeSharpenMask2, int>(src, out, border);
 }
 
-CImg<unsigned char> edge_sharpen_optimized(const CImg<unsigned char>& src) {
+void edge_sharpen_type3(const CImg<unsigned char>& src, CImg<unsigned char>& out,
+                        const Border& border) {
+    convolve<EdgeSharpenMask3, int>(src, out, border);
+}
+
+void edge_sharpen_optimized(const CImg<unsigned char>& src, CImg<unsigned char>& out,
+                            const Border& border) {
     // Optimized version of type1: uses fewer multiplications
     // g = f + (f - lowpass(f))
+    if (&out == &src) {
+        CImg<unsigned char> tmp;
+        edge_sharpen_optimized(src, tmp, border);
+        out.swap(tmp);
+        return;
+    }
     int w = src.width(), h = src.height(), s = src.spectrum();
-    CImg<unsigned char> out(w, h, 1, s);
+    out.assign(w, h, 1, s);
     
-    for (int c = 0; c < s; ++c) {
-        cimg_forXY(src, x, y) {
-            int original = src(x, y, c);
-            
-            // Compute average of 4 neighbors (cross pattern)
-            int sum = getp(src, x-1, y, c) + getp(src, x+1, y, c) +
-                      getp(src, x, y-1, c) + getp(src, x, y+1, c);
-            int avg = sum / 4;
-            
-            // Sharpen: original + (original - average)
-            int sharpened = original + (original - avg);
-            out(x, y, c) = (unsigned char)clampv(sharpened, 0, 255);
+    parallel_for_rows(s, h, [&](int c, int y0, int y1) {
+        const unsigned char* sp = src.data(0, 0, 0, c);
+        unsigned char* dp = out.data(0, 0, 0, c);
+        
+        // Interior: all four neighbours are in range
+        for (int y = max(y0, 1); y < min(y1, h - 1); ++y) {
+            const unsigned char* p = sp + (size_t)y * w;
+            unsigned char* d = dp + (size_t)y * w;
+            for (int x = 1; x < w - 1; ++x) {
+                int original = p[x];
+                // Average of 4 neighbors (cross pattern)
+                int avg = (p[x - 1] + p[x + 1] + p[x - w] + p[x + w]) / 4;
+                // Sharpen: original + (original - average)
+                d[x] = (unsigned char)clampv(original + (original - avg), 0, 255);
+            }
         }
-    }
+        
+        for_each_frame_pixel(w, h, 1, 1, y0, y1, [&](int x, int y) {
+            size_t idx = (size_t)y * w + x;
+            int original = sp[idx];
+            if (border.mode == BORDER_COPY) {
+                dp[idx] = (unsigned char)original;
+                return;
+            }
+            int sum = border_fetch(sp, w, h, x - 1, y, border) +
+                      border_fetch(sp, w, h, x + 1, y, border) +
+                      border_fetch(sp, w, h, x, y - 1, border) +
+                      border_fetch(sp, w, h, x, y + 1, border);
+            int avg = sum / 4;
+            dp[idx] = (unsigned char)clampv(original + (original - avg), 0, 255);
+        });
+    });
+}
+
+CImg<unsigned char> edge_sharpen_type1(const CImg<unsigned char>& src,
+                                       const Border& border) {
+    CImg<unsigned char> out;
+    edge_sharpen_type1(src, out, border);
+    return out;
+}
+
+CImg<unsigned char> edge_sharpen_type2(const CImg<unsigned char>& src,
+                                       const Border& border) {
+    CImg<unsigned char> out;
+    edge_sharpen_type2(src, out, border);
+    return out;
+}
+
+CImg<unsigned char> edge_sharpen_type3(const CImg<unsigned char>& src,
+                                       const Border& border) {
+    CImg<unsigned char> out;
+    edge_sharpen_type3(src, out, border);
+    return out;
+}
+
+CImg<unsigned char> edge_sharpen_optimized(const CImg<unsigned char>& src,
+                                           const Border& border) {
+    CImg<unsigned char> out;
+    edge_sharpen_optimized(src, out, border);
     return out;
 }
@@ -2,17 +2,96 @@
 #define LINEAR_FILTERS_H
 
 #include "Utils.h"
+#include "Border.h"
+#include "Convolve.h"
+
+// Rank-1 test: on success kernel == col * row^T (within float tolerance)
+bool kernel_separable(const std::vector<std::vector<float>>& kernel,
+                      std::vector<float>& col, std::vector<float>& row);
+
+// Largest number of fraction bits kernel_fixed_point() tries
+const int FIXED_POINT_MAX_SHIFT = 16;
+
+// Fixed-point test: on success kernel == taps / 2^shift exactly (taps
+// row-major, shift as small as possible), and 255 * sum|taps| < 2^24, so
+// integer and float accumulation both give the exact sum
+bool kernel_fixed_point(const std::vector<std::vector<float>>& kernel,
+                        std::vector<int>& taps, int& shift);
 
 // Universal convolution (works with any mask)
+// Masks passing kernel_fixed_point() run in integer arithmetic where that
+// pays (int16 SIMD lanes when the sums fit, else 32-bit separable passes).
+// Otherwise separable masks run as two 1D float passes; other 3x3, 5x5
+// and 7x7 masks through the unrolled loop of Convolve.h, larger ones a
+// row-blocked loop. A cost model over mask and image size switches to
+// convolve_fft() where that is cheaper, typically from about 9x9 for
+// float masks and 31x31 for int16 ones.
 CImg<unsigned char> convolve_universal(const CImg<unsigned char>& src,
-                                       const std::vector<std::vector<float>>& kernel);
+                                       const std::vector<std::vector<float>>& kernel,
+                                       const Border& border = Border(BORDER_COPY));
+
+// S2 masks of variants 1-3 as compile-time kernels for convolve<K, int>
+struct EdgeSharpenMask1 {  // center=5, cross=-1
+    static constexpr int size = 3;
+    static constexpr short taps[9] = {  0, -1,  0,
+                                       -1,  5, -1,
+                                        0, -1,  0 };
+};
+
+struct EdgeSharpenMask2 {  // center=9, all neighbors=-1
+    static constexpr int size = 3;
+    static constexpr short taps[9] = { -1, -1, -1,
+                                       -1,  9, -1,
+                                       -1, -1, -1 };
+};
+
+struct EdgeSharpenMask3 {  // center=5, diagonal=1, cross=-2
+    static constexpr int size = 3;
+    static constexpr short taps[9] = {  1, -2,  1,
+                                       -2,  5, -2,
+                                        1, -2,  1 };
+};
+
+// Largest FFT block edge convolve_fft() uses
+const int FFT_MAX_BLOCK = 1024;
+
+// Convolution through FFT blocks (overlap-save): O(log) per pixel whatever
+// the mask size. Same border handling as convolve_universal(); double
+// precision keeps results within 1 of the direct sum (equal except at
+// exact .5 roundings), and equal to it for masks passing
+// kernel_fixed_point(). Throws for non-square masks.
+void convolve_fft(const CImg<unsigned char>& src, CImg<unsigned char>& dst,
+                  const std::vector<std::vector<float>>& kernel,
+                  const Border& border = Border(BORDER_COPY));
+
+// The 3x3 mask of edge sharpening variant 1, 2 or 3 (row-major);
+// throws for other variants
+const short* edge_sharpen_mask(int variant);
 
 // S2: Edge sharpening variants
-CImg<unsigned char> edge_sharpen_type1(const CImg<unsigned char>& src);
-CImg<unsigned char> edge_sharpen_type2(const CImg<unsigned char>& src);
-CImg<unsigned char> edge_sharpen_type3(const CImg<unsigned char>& src);
+CImg<unsigned char> edge_sharpen_type1(const CImg<unsigned char>& src,
+                                       const Border& border = Border(BORDER_COPY));
+CImg<unsigned char> edge_sharpen_type2(const CImg<unsigned char>& src,
+                                       const Border& border = Border(BORDER_COPY));
+CImg<unsigned char> edge_sharpen_type3(const CImg<unsigned char>& src,
+                                       const Border& border = Border(BORDER_COPY));
 
 // Optimized edge sharpening
-CImg<unsigned char> edge_sharpen_optimized(const CImg<unsigned char>& src);
+CImg<unsigned char> edge_sharpen_optimized(const CImg<unsigned char>& src,
+                                           const Border& border = Border(BORDER_CLAMP));
+
+// Variants writing into dst, which is resized to match src and keeps its
+// storage when it already fits. dst may be src (a temporary is used).
+void convolve_universal(const CImg<unsigned char>& src, CImg<unsigned char>& dst,
+                        const std::vector<std::vector<float>>& kernel,
+                        const Border& border = Border(BORDER_COPY));
+void edge_sharpen_type1(const CImg<unsigned char>& src, CImg<unsigned char>& dst,
+                        const Border& border = Border(BORDER_COPY));
+void edge_sharpen_type2(const CImg<unsigned char>& src, CImg<unsigned char>& dst,
+                        const Border& border = Border(BORDER_COPY));
+void edge_sharpen_type3(const CImg<unsigned char>& src, CImg<unsigned char>& dst,
+                        const Border& border = Border(BORDER_COPY));
+void edge_sharpen_optimized(const CImg<unsigned char>& src, CImg<unsigned char>& dst,
+                            const Border& border = Border(BORDER_CLAMP));
 
 #endif
@@ -0,0 +1,153 @@
+#include "MappedBmp.h"
+#include "Histogram.h"
+#include "Parallel.h"
+#include <cstring>
+#include <fcntl.h>
+#include <utility>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+static uint32_t le32(const unsigned char* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+MappedBmp::MappedBmp()
+    : map_(NULL), mapSize_(0), pixels_(NULL), width_(0), height_(0), bpp_(0),
+      bottomUp_(true), stride_(0) {}
+
+MappedBmp::~MappedBmp() {
+    close();
+}
+
+void MappedBmp::close() {
+    if (map_) munmap(map_, mapSize_);
+    map_ = NULL;
+    pixels_ = NULL;
+}
+
+bool MappedBmp::open(const string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw runtime_error("Cannot open " + path);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw runtime_error("Cannot read " + path);
+    }
+    size_t size = (size_t)st.st_size;
+    void* map = size >= 54 ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    ::close(fd);  // The mapping keeps the file alive
+    if (map == MAP_FAILED) return false;
+    map_ = map;
+    mapSize_ = size;
+    if (!parse((const unsigned char*)map, size, path)) return false;
+
+    // Pages are faulted in by the decoding threads; ask for read-ahead
+    madvise(map_, mapSize_, MADV_WILLNEED);
+    return true;
+}
+
+bool MappedBmp::open_memory(const unsigned char* data, size_t size, const string& name) {
+    close();
+    return size >= 54 && parse(data, size, name);
+}
+
+// Validate the file header and point the accessors into the file
+bool MappedBmp::parse(const unsigned char* header, size_t size, const string& name) {
+    uint32_t dataOffset = le32(header + 0x0A);
+    uint32_t headerSize = le32(header + 0x0E);
+    int32_t dy = (int32_t)le32(header + 0x16);
+    uint32_t colors = le32(header + 0x2E);
+    width_ = (int32_t)le32(header + 0x12);
+    height_ = dy < 0 ? -dy : dy;
+    bpp_ = header[0x1C] | (header[0x1D] << 8);
+    bottomUp_ = dy > 0;
+    if (header[0] != 'B' || header[1] != 'M' || le32(header + 0x1E) != 0 ||
+        (bpp_ != 8 && bpp_ != 24) || width_ <= 0 || height_ <= 0) {
+        close();
+        return false;
+    }
+
+    stride_ = ((size_t)width_ * bpp_ / 8 + 3) & ~(size_t)3;
+    if (dataOffset + stride_ * height_ > size) {
+        close();
+        throw runtime_error("Truncated BMP file: " + name);
+    }
+    pixels_ = header + dataOffset;
+
+    if (bpp_ == 8) {
+        // Entries the file does not list decode as black
+        if (colors == 0 || colors > 256) colors = 256;
+        size_t paletteOffset = 14 + (size_t)headerSize;
+        if (paletteOffset + 4 * colors > dataOffset) {
+            close();
+            throw runtime_error("Truncated BMP palette: " + name);
+        }
+        palette_.assign(1024, 0);
+        memcpy(palette_.data(), header + paletteOffset, 4 * colors);
+    }
+
+    return true;
+}
+
+void MappedBmp::to_planar(CImg<unsigned char>& dst) const {
+    int w = width_;
+    dst.assign(w, height_, 1, 3);
+
+    parallel_for_rows(1, height_, [&](int, int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            const unsigned char* p = row(y);
+            unsigned char* r = dst.data(0, y, 0, 0);
+            unsigned char* g = dst.data(0, y, 0, 1);
+            unsigned char* b = dst.data(0, y, 0, 2);
+            if (bpp_ == 24) {
+                for (int x = 0; x < w; ++x, p += 3) {
+                    b[x] = p[0];
+                    g[x] = p[1];
+                    r[x] = p[2];
+                }
+            } else {
+                const unsigned char* pal = palette_.data();
+                for (int x = 0; x < w; ++x) {
+                    const unsigned char* col = pal + 4 * p[x];
+                    b[x] = col[0];
+                    g[x] = col[1];
+                    r[x] = col[2];
+                }
+            }
+        }
+    });
+}
+
+vector<vector<uint64_t>> MappedBmp::histograms() const {
+    // File rows in file order: the order does not matter for counting
+    int channels = bpp_ == 24 ? 3 : 1;
+    vector<vector<uint64_t>> counts =
+        compute_histograms(pixels_, width_, height_, channels, stride_);
+    if (bpp_ == 24) {
+        swap(counts[0], counts[2]);  // File order is B, G, R
+        return counts;
+    }
+    // Every index adds its count at its palette colour in each channel
+    vector<vector<uint64_t>> hists(3, vector<uint64_t>(256, 0));
+    for (int i = 0; i < 256; ++i) {
+        const unsigned char* col = &palette_[4 * i];
+        hists[0][col[2]] += counts[0][i];
+        hists[1][col[1]] += counts[0][i];
+        hists[2][col[0]] += counts[0][i];
+    }
+    return hists;
+}
+
+void load_image(const string& path, CImg<unsigned char>& img) {
+    MappedBmp bmp;
+    if (bmp.open(path)) {
+        bmp.to_planar(img);
+    } else {
+        img.load(path.c_str());
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef MAPPED_BMP_H
+#define MAPPED_BMP_H
+
+#include "Utils.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Read-only memory map of an uncompressed 8-bit (palette) or 24-bit BMP.
+// The header is validated once on open(); pixel rows are then used in
+// place from the mapping. Commands that only need histograms count the
+// file rows directly; everything else calls to_planar(), which
+// de-interleaves into CImg's planar RGB layout in one parallel pass.
+class MappedBmp {
+public:
+    MappedBmp();
+    ~MappedBmp();
+
+    MappedBmp(const MappedBmp&) = delete;
+    MappedBmp& operator=(const MappedBmp&) = delete;
+
+    // Map path. Returns false, with nothing mapped, if the file is not an
+    // uncompressed 8 or 24-bit BMP (callers then fall back to CImg).
+    // Throws runtime_error on unreadable or truncated files.
+    bool open(const std::string& path);
+
+    // Same for a BMP file already in memory, used in place: data must
+    // outlive the object or the next open
+    bool open_memory(const unsigned char* data, size_t size, const std::string& name);
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    int bpp() const { return bpp_; }
+
+    // Raw file row y (top-down), no copy; stride() bytes apart in file order
+    const unsigned char* row(int y) const {
+        return pixels_ + stride_ * (size_t)(bottomUp_ ? height_ - 1 - y : y);
+    }
+    size_t stride() const { return stride_; }
+
+    // Decode to planar RGB, the same image CImg's load_bmp returns
+    void to_planar(CImg<unsigned char>& dst) const;
+
+    // Histograms of the R, G and B channels of the decoded image, counted
+    // from the raw rows (8-bit: palette indices, then mapped per channel)
+    std::vector<std::vector<uint64_t>> histograms() const;
+
+private:
+    void close();
+    bool parse(const unsigned char* header, size_t size, const std::string& name);
+
+    void* map_;
+    size_t mapSize_;
+    const unsigned char* pixels_;
+    int width_, height_, bpp_;
+    bool bottomUp_;
+    size_t stride_;
+    std::vector<unsigned char> palette_;  // 256 BGRA entries (8-bit only)
+};
+
+// Decode path into img: through MappedBmp when it handles the file, CImg
+// otherwise
+void load_image(const std::string& path, CImg<unsigned char>& img);
+
+#endif
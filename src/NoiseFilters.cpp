@@ -0,0 +1,656 @@
+#include "NoiseFilters.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+// round(sum / d), halves up, as a multiply instead of a division. With
+// sum + d/2 an integer, sum + d/2 + 0.5 sits at least 1/(2d) from a
+// multiple of d, far more than the error of the double product, so the
+// truncation is exact for every 32-bit sum.
+struct RoundedDivider {
+    double inv;
+    uint32_t half;
+
+    explicit RoundedDivider(uint32_t d) : inv(1.0 / d), half(d / 2) {}
+    uint32_t operator()(uint32_t sum) const {
+        return (uint32_t)(((double)sum + half + 0.5) * inv);
+    }
+};
+
+// Border value as a pixel: sums are unsigned
+static int outside_value(const Border& border) {
+    return clampv(border.value, 0, 255);
+}
+
+static void check_box(int rx, int ry) {
+    if (rx < 0 || ry < 0) throw runtime_error("Box radius must be >= 0");
+    if ((2 * (uint64_t)rx + 1) * (2 * (uint64_t)ry + 1) > BOX_MAX_AREA) {
+        throw runtime_error("Box window too large");
+    }
+}
+
+static void copy_frame(const unsigned char* sp, unsigned char* dp, int w, int h,
+                       int rx, int ry, int y0, int y1) {
+    for_each_frame_pixel(w, h, rx, ry, y0, y1, [&](int x, int y) {
+        size_t idx = (size_t)y * w + x;
+        dp[idx] = sp[idx];
+    });
+}
+
+// Rows [y0, y1) of one plane. col[x] holds the sum of the 2 ry + 1 rows
+// around y in column x; the padded row of column sums then gets a running
+// sum along x.
+static void box_plane(const unsigned char* sp, unsigned char* dp, int w, int h,
+                      int rx, int ry, const Border& border, int y0, int y1) {
+    int value = outside_value(border);
+    vector<unsigned char> constant_row(w, value);
+    vector<uint32_t> col(w, 0), row(w + 2 * rx);
+    uint32_t outside_col = (uint32_t)value * (2 * ry + 1);
+    RoundedDivider div((2 * rx + 1) * (2 * ry + 1));
+
+    // Row y resolved through the border mode
+    auto row_at = [&](int y) {
+        int by = border_index(y, h, border.mode);
+        return by < 0 ? constant_row.data() : sp + (size_t)by * w;
+    };
+
+    for (int i = -ry; i <= ry; ++i) {
+        const unsigned char* r = row_at(y0 + i);
+        for (int x = 0; x < w; ++x) col[x] += r[x];
+    }
+
+    for (int y = y0; y < y1; ++y) {
+        // Column sums padded by rx; outside CONSTANT columns every row is value
+        memcpy(&row[rx], col.data(), w * sizeof(uint32_t));
+        for (int i = 0; i < rx; ++i) {
+            int left = border_index(i - rx, w, border.mode);
+            int right = border_index(w + i, w, border.mode);
+            row[i] = left < 0 ? outside_col : col[left];
+            row[w + rx + i] = right < 0 ? outside_col : col[right];
+        }
+
+        unsigned char* d = dp + (size_t)y * w;
+        uint32_t sum = 0;
+        for (int i = 0; i < 2 * rx; ++i) sum += row[i];
+        for (int x = 0; x < w; ++x) {
+            sum += row[x + 2 * rx];
+            d[x] = (unsigned char)div(sum);
+            sum -= row[x];
+        }
+
+        // Slide the column sums down one row
+        const unsigned char* enter = row_at(y + ry + 1);
+        const unsigned char* leave = row_at(y - ry);
+        for (int x = 0; x < w; ++x) col[x] += enter[x] - leave[x];
+    }
+
+    if (border.mode == BORDER_COPY) copy_frame(sp, dp, w, h, rx, ry, y0, y1);
+}
+
+void box_filter(const CImg<unsigned char>& src, CImg<unsigned char>& dst, int rx, int ry,
+                const Border& border) {
+    check_box(rx, ry);
+    if (&dst == &src) {
+        CImg<unsigned char> tmp;
+        box_filter(src, tmp, rx, ry, border);
+        dst.swap(tmp);
+        return;
+    }
+    int w = src.width(), h = src.height(), s = src.spectrum();
+    dst.assign(w, h, 1, s);
+
+    parallel_for_rows(s, h, [&](int c, int y0, int y1) {
+        box_plane(src.data(0, 0, 0, c), dst.data(0, 0, 0, c), w, h, rx, ry, border, y0, y1);
+    });
+}
+
+void IntegralImage::build(const unsigned char* plane, int w, int h, int padX, int padY,
+                          const Border& border) {
+    padX_ = padX;
+    padY_ = padY;
+    stride_ = w + 2 * padX + 1;
+    table_.assign((size_t)stride_ * (h + 2 * padY + 1), 0);
+
+    int value = outside_value(border);
+    vector<int> cols(w + 2 * padX);
+    for (int i = 0; i < w + 2 * padX; ++i) cols[i] = border_index(i - padX, w, border.mode);
+
+    // Entry (i, j) sums the padded plane above and left of it: the one
+    // above plus a running sum along the row
+    for (int j = 0; j < h + 2 * padY; ++j) {
+        int by = border_index(j - padY, h, border.mode);
+        const unsigned char* p = by < 0 ? nullptr : plane + (size_t)by * w;
+        const uint32_t* above = &table_[(size_t)j * stride_];
+        uint32_t* t = &table_[(size_t)(j + 1) * stride_];
+        uint32_t run = 0;
+        for (int i = 0; i < w + 2 * padX; ++i) {
+            run += (p && cols[i] >= 0) ? p[cols[i]] : value;
+            t[i + 1] = above[i + 1] + run;
+        }
+    }
+}
+
+void box_filter_integral(const CImg<unsigned char>& src, CImg<unsigned char>& dst,
+                         int rx, int ry, const Border& border) {
+    check_box(rx, ry);
+    if (&dst == &src) {
+        CImg<unsigned char> tmp;
+        box_filter_integral(src, tmp, rx, ry, border);
+        dst.swap(tmp);
+        return;
+    }
+    int w = src.width(), h = src.height(), s = src.spectrum();
+    dst.assign(w, h, 1, s);
+    RoundedDivider div((2 * rx + 1) * (2 * ry + 1));
+
+    // The table is a serial prefix sum: built per plane, queried in parallel
+    IntegralImage table;
+    for (int c = 0; c < s; ++c) {
+        const unsigned char* sp = src.data(0, 0, 0, c);
+        unsigned char* dp = dst.data(0, 0, 0, c);
+        table.build(sp, w, h, rx, ry, border);
+        parallel_for_rows(1, h, [&](int, int y0, int y1) {
+            for (int y = y0; y < y1; ++y) {
+                const uint32_t* top = table.row(y - ry);
+                const uint32_t* bottom = table.row(y + ry + 1);
+                unsigned char* d = dp + (size_t)y * w;
+                for (int x = 0; x < w; ++x) {
+                    d[x] = (unsigned char)div(bottom[x + rx + 1] - bottom[x - rx] -
+                                              top[x + rx + 1] + top[x - rx]);
+                }
+            }
+            if (border.mode == BORDER_COPY) copy_frame(sp, dp, w, h, rx, ry, y0, y1);
+        });
+    }
+}
+
+void gaussian_box_radii(float sigma, int radii[GAUSSIAN_BOX_PASSES]) {
+    if (!(sigma > 0 && sigma <= GAUSSIAN_MAX_SIGMA)) {
+        throw runtime_error("Sigma must be in (0, " + to_string((int)GAUSSIAN_MAX_SIGMA) + "]");
+    }
+    // A box of odd width d has variance (d^2 - 1) / 12. Use the widest odd
+    // width below the ideal one for the first m passes and the next odd
+    // width for the rest, with m picked so the total is closest to sigma^2.
+    const int n = GAUSSIAN_BOX_PASSES;
+    double var = (double)sigma * sigma;
+    int lower = (int)floor(sqrt(12 * var / n + 1));
+    if (lower % 2 == 0) --lower;
+    double m = (12 * var - n * lower * lower - 4 * n * lower - 3 * n) / (-4 * lower - 4);
+    int smaller = clampv((int)lround(m), 0, n);
+    for (int i = 0; i < n; ++i) {
+        int width = i < smaller ? lower : lower + 2;
+        radii[i] = width / 2;
+    }
+}
+
+int gaussian_blur_radius(float sigma) {
+    int radii[GAUSSIAN_BOX_PASSES];
+    gaussian_box_radii(sigma, radii);
+    int total = 0;
+    for (int r : radii) total += r;
+    return total;
+}
+
+// One vertical box pass fed a row at a time. Each row is written to
+// next() and then pushed: push() adds it to the column sums and, once
+// 2r + 1 rows are in, writes the mean of the last 2r + 1 (the output row
+// r rows back) to out, drops the oldest and returns true. Rows land
+// straight in the ring, so the passes chain without copies.
+class VerticalBox {
+public:
+    VerticalBox(int w, int r)
+        : w_(w), n_(2 * r + 1), rows_(0), sum_(w, 0), ring_((size_t)w * n_), div_(n_) {}
+
+    uint16_t* next() { return &ring_[(size_t)(rows_ % n_) * w_]; }
+
+    bool push(uint16_t* out) {
+        const uint16_t* in = next();
+        const uint16_t* oldest = &ring_[(size_t)((rows_ + 1) % n_) * w_];
+        if (++rows_ < n_) {
+            for (int x = 0; x < w_; ++x) sum_[x] += in[x];
+            return false;
+        }
+        // With r = 0 the oldest row is in itself, which still works
+        for (int x = 0; x < w_; ++x) {
+            uint32_t s = sum_[x] + in[x];
+            out[x] = (uint16_t)div_(s);
+            sum_[x] = s - oldest[x];
+        }
+        return true;
+    }
+
+private:
+    int w_, n_, rows_;
+    vector<uint32_t> sum_;
+    vector<uint16_t> ring_;  // The last n_ rows pushed
+    RoundedDivider div_;
+};
+
+// Horizontal box pass over n outputs in place: a[x] = mean of a[x .. x + 2r],
+// written to out[x] (out may be a)
+template <typename T>
+static void box_line(uint16_t* a, T* out, int n, int r, const RoundedDivider& div) {
+    uint32_t sum = 0;
+    for (int i = 0; i < 2 * r; ++i) sum += a[i];
+    for (int x = 0; x < n; ++x) {
+        sum += a[x + 2 * r];
+        uint16_t leaving = a[x];
+        out[x] = (T)div(sum);
+        sum -= leaving;
+    }
+}
+
+// Smallest band height of gaussian_blur(), in multiples of the 2R rows of
+// halo each band adds
+static const int GAUSSIAN_BAND_HALOS = 4;
+
+// Rows [y0, y1) of one plane. Source rows y0 - R .. y1 + R - 1 (R the sum
+// of the radii) go through the vertical passes one by one; each row coming
+// out of the last is padded by R and run through the horizontal passes.
+// Padding the source rather than each pass's input makes the result the
+// stacked boxes over the border-extended image.
+static void gaussian_plane(const unsigned char* sp, unsigned char* dp, int w, int h,
+                           const int* radii, const Border& border, int y0, int y1) {
+    const int n = GAUSSIAN_BOX_PASSES;
+    int R = 0;
+    for (int i = 0; i < n; ++i) R += radii[i];
+    uint16_t value = outside_value(border) << 8;
+
+    vector<VerticalBox> vertical;
+    vector<RoundedDivider> horizontal;
+    for (int i = 0; i < n; ++i) {
+        vertical.push_back(VerticalBox(w, radii[i]));
+        // The last pass also drops the 8 fraction bits
+        horizontal.push_back(RoundedDivider((2 * radii[i] + 1) << (i == n - 1 ? 8 : 0)));
+    }
+
+    vector<uint16_t> line(w + 2 * R);
+    vector<int> cols(2 * R);
+    for (int i = 0; i < R; ++i) {
+        cols[i] = border_index(i - R, w, border.mode);
+        cols[R + i] = border_index(w + i, w, border.mode);
+    }
+
+    for (int y = y0 - R; y < y1 + R; ++y) {
+        int by = border_index(y, h, border.mode);
+        uint16_t* in = vertical[0].next();
+        if (by < 0) {
+            fill(in, in + w, value);
+        } else {
+            const unsigned char* p = sp + (size_t)by * w;
+            for (int x = 0; x < w; ++x) in[x] = p[x] << 8;
+        }
+        bool ready = true;
+        for (int i = 0; i < n && ready; ++i) {
+            ready = vertical[i].push(i + 1 < n ? vertical[i + 1].next() : &line[R]);
+        }
+        if (!ready) continue;
+
+        // Row y - R of the vertical result, padded like the source
+        const uint16_t* row = &line[R];
+        for (int i = 0; i < R; ++i) {
+            line[i] = cols[i] < 0 ? value : row[cols[i]];
+            line[w + R + i] = cols[R + i] < 0 ? value : row[cols[R + i]];
+        }
+        int len = w + 2 * R;
+        for (int i = 0; i < n - 1; ++i) {
+            len -= 2 * radii[i];
+            box_line(line.data(), line.data(), len, radii[i], horizontal[i]);
+        }
+        box_line(line.data(), dp + (size_t)(y - R) * w, w, radii[n - 1], horizontal[n - 1]);
+    }
+
+    if (border.mode == BORDER_COPY) copy_frame(sp, dp, w, h, R, R, y0, y1);
+}
+
+void gaussian_blur(const CImg<unsigned char>& src, CImg<unsigned char>& dst, float sigma,
+                   const Border& border) {
+    int radii[GAUSSIAN_BOX_PASSES];
+    gaussian_box_radii(sigma, radii);
+    if (&dst == &src) {
+        CImg<unsigned char> tmp;
+        gaussian_blur(src, tmp, sigma, border);
+        dst.swap(tmp);
+        return;
+    }
+    int w = src.width(), h = src.height(), s = src.spectrum();
+    dst.assign(w, h, 1, s);
+
+    // Every band runs the vertical passes over 2R rows beyond its own.
+    // Bands GAUSSIAN_BAND_HALOS times that tall keep the extra work below
+    // 1 / GAUSSIAN_BAND_HALOS whatever sigma; otherwise ~4 bands per thread
+    // as in parallel_for_rows(). Large sigma thus gets fewer bands, down to
+    // one per plane.
+    int R = gaussian_blur_radius(sigma);
+    int perChannel = max(1, (4 * thread_count() + s - 1) / s);
+    int band = max(2 * R * GAUSSIAN_BAND_HALOS, (h + perChannel - 1) / perChannel);
+    int bands = (h + band - 1) / band;
+    parallel_for(s * bands, [&](int i) {
+        int c = i / bands, y0 = (i % bands) * band;
+        gaussian_plane(src.data(0, 0, 0, c), dst.data(0, 0, 0, c), w, h, radii, border,
+                       y0, min(h, y0 + band));
+    });
+}
+
+CImg<unsigned char> op_amean(const CImg<unsigned char>& src, int kernelSize) {
+    if (kernelSize < 3 || kernelSize % 2 == 0) {
+        throw runtime_error("Kernel size must be odd and >= 3");
+    }
+    CImg<unsigned char> out;
+    box_filter(src, out, kernelSize / 2, kernelSize / 2);
+    return out;
+}
+
+// Median histograms are two-level: 16 coarse bins of 16 fine bins each
+const int HIST_SEGMENT = 16;
+
+// Index of the bin holding the value with k values below it, k reduced
+// by the bins before it
+static int scan_bins(const uint16_t* h, int& k) {
+    int i = 0;
+    for (; k >= h[i]; ++i) k -= h[i];
+    return i;
+}
+
+// Value with k values below it, in a two-level histogram of more than k;
+// less and equal count the values smaller than and equal to it
+static int hist_rank(const uint16_t* coarse, const uint16_t* fine, int k,
+                     int& less, int& equal) {
+    int left = k;
+    int b = scan_bins(coarse, left);
+    int v = b * HIST_SEGMENT + scan_bins(fine + b * HIST_SEGMENT, left);
+    less = k - left;
+    equal = fine[v];
+    return v;
+}
+
+// Whether coarse bins before segment b (after it, with above) hold values
+static bool coarse_beyond(const uint16_t* coarse, int b, bool above) {
+    for (int i = above ? b + 1 : 0; i < (above ? HIST_SEGMENT : b); ++i) {
+        if (coarse[i]) return true;
+    }
+    return false;
+}
+
+// Whether fine bins of v's segment below v (above v, with above) hold values
+static bool fine_beyond(const uint16_t* fine, int v, bool above) {
+    int end = (v / HIST_SEGMENT + 1) * HIST_SEGMENT;
+    for (int i = above ? v + 1 : v - v % HIST_SEGMENT; i < (above ? end : v); ++i) {
+        if (fine[i]) return true;
+    }
+    return false;
+}
+
+// Window histogram of the median filters over one plane. The column
+// histograms cover rows y - r .. y + r of the current row y; padded columns
+// map through the border mode, CONSTANT ones to an extra column holding
+// only the border value. The window keeps all 16 coarse bins current as it
+// slides, but a fine segment only when a search enters it, catching up by
+// replaying the columns it missed or rebuilding from the 2r + 1 in the
+// window, whichever is less work.
+class MedianHistogram {
+public:
+    MedianHistogram(const unsigned char* plane, int w, int h, int r, const Border& border)
+        : plane_(plane), w_(w), h_(h), r_(r), mode_(border.mode),
+          constantRow_(w, outside_value(border)), cols_(w + 2 * r),
+          colCoarse_((size_t)(w + 1) * HIST_SEGMENT), colFine_((size_t)(w + 1) * 256), x_(0) {
+        for (int i = 0; i < w + 2 * r; ++i) {
+            int bx = border_index(i - r, w, border.mode);
+            cols_[i] = bx < 0 ? w : bx;
+        }
+        int value = outside_value(border);
+        colCoarse_[(size_t)w * HIST_SEGMENT + value / HIST_SEGMENT] = 2 * r + 1;
+        colFine_[(size_t)w * 256 + value] = 2 * r + 1;
+    }
+
+    // Column histograms of rows y - r .. y + r
+    void start_row(int y) {
+        fill(colCoarse_.begin(), colCoarse_.begin() + (size_t)w_ * HIST_SEGMENT, 0);
+        fill(colFine_.begin(), colFine_.begin() + (size_t)w_ * 256, 0);
+        for (int i = -r_; i <= r_; ++i) update_columns(row_at(y + i), 1);
+    }
+
+    // From row y to y + 1
+    void next_row(int y) {
+        update_columns(row_at(y + r_ + 1), 1);
+        update_columns(row_at(y - r_), -1);
+    }
+
+    // Window at x = 0 of the current row
+    void start() {
+        x_ = 0;
+        fill(coarse_, coarse_ + HIST_SEGMENT, 0);
+        for (int i = 0; i <= 2 * r_; ++i) {
+            const uint16_t* c = &colCoarse_[(size_t)cols_[i] * HIST_SEGMENT];
+            for (int b = 0; b < HIST_SEGMENT; ++b) coarse_[b] += c[b];
+        }
+        fill(stamp_, stamp_ + HIST_SEGMENT, -(1 << 30));  // Every segment stale
+    }
+
+    // From x to x + 1
+    void next() {
+        slide(coarse_, &colCoarse_[(size_t)cols_[x_ + 1 + 2 * r_] * HIST_SEGMENT],
+              &colCoarse_[(size_t)cols_[x_] * HIST_SEGMENT]);
+        ++x_;
+    }
+
+    // Value with k values below it in the window, as hist_rank()
+    int rank(int k, int& less, int& equal) {
+        int left = k;
+        int b = scan_bins(coarse_, left);
+        refresh(b);
+        int v = b * HIST_SEGMENT + scan_bins(fine_ + b * HIST_SEGMENT, left);
+        less = k - left;
+        equal = fine_[v];
+        return v;
+    }
+
+    // Whether the window holds a value below v (above v, with above). The
+    // fine segment is only needed when no other segment decides it.
+    bool holds_beyond(int v, bool above) {
+        int b = v / HIST_SEGMENT;
+        if (coarse_beyond(coarse_, b, above)) return true;
+        refresh(b);
+        return fine_beyond(fine_, v, above);
+    }
+
+    // The whole window histogram, every fine segment brought up to date
+    void copy_to(uint16_t* coarse, uint16_t* fine) {
+        for (int b = 0; b < HIST_SEGMENT; ++b) refresh(b);
+        copy(coarse_, coarse_ + HIST_SEGMENT, coarse);
+        copy(fine_, fine_ + 256, fine);
+    }
+
+private:
+    const unsigned char* row_at(int y) const {
+        int by = border_index(y, h_, mode_);
+        return by < 0 ? constantRow_.data() : plane_ + (size_t)by * w_;
+    }
+
+    void update_columns(const unsigned char* row, int sign) {
+        for (int x = 0; x < w_; ++x) {
+            colCoarse_[(size_t)x * HIST_SEGMENT + row[x] / HIST_SEGMENT] += sign;
+            colFine_[(size_t)x * 256 + row[x]] += sign;
+        }
+    }
+
+    // h += enter - leave over one segment. The difference goes through a
+    // local array, which cannot alias h, so the loops vectorize.
+    static void slide(uint16_t* h, const uint16_t* enter, const uint16_t* leave) {
+        uint16_t delta[HIST_SEGMENT];
+        for (int i = 0; i < HIST_SEGMENT; ++i) delta[i] = enter[i] - leave[i];
+        for (int i = 0; i < HIST_SEGMENT; ++i) h[i] += delta[i];
+    }
+
+    const uint16_t* fine_segment(int col, int b) const {
+        return &colFine_[(size_t)col * 256 + b * HIST_SEGMENT];
+    }
+
+    void refresh(int b) {
+        int age = x_ - stamp_[b];
+        if (age == 0) return;
+        uint16_t f[HIST_SEGMENT];
+        copy(fine_ + b * HIST_SEGMENT, fine_ + (b + 1) * HIST_SEGMENT, f);
+        if (age > r_) {
+            fill(f, f + HIST_SEGMENT, 0);
+            for (int i = x_; i <= x_ + 2 * r_; ++i) {
+                const uint16_t* c = fine_segment(cols_[i], b);
+                for (int j = 0; j < HIST_SEGMENT; ++j) f[j] += c[j];
+            }
+        } else {
+            for (int s = stamp_[b] + 1; s <= x_; ++s) {
+                slide(f, fine_segment(cols_[s + 2 * r_], b), fine_segment(cols_[s - 1], b));
+            }
+        }
+        copy(f, f + HIST_SEGMENT, fine_ + b * HIST_SEGMENT);
+        stamp_[b] = x_;
+    }
+
+    const unsigned char* plane_;
+    int w_, h_, r_;
+    BorderMode mode_;
+    vector<unsigned char> constantRow_;
+    vector<int> cols_;                   // Padded column x + r -> histogram
+    vector<uint16_t> colCoarse_, colFine_;
+    int x_;
+    uint16_t coarse_[HIST_SEGMENT], fine_[256];
+    int stamp_[HIST_SEGMENT];            // x at which each fine segment was current
+};
+
+static void check_median_size(int size, const char* what) {
+    if (size < 1 || size % 2 == 0 || size > MEDIAN_MAX_SIZE) {
+        throw runtime_error(string(what) + " must be odd and at most " +
+                            to_string(MEDIAN_MAX_SIZE));
+    }
+}
+
+static void median_plane(const unsigned char* sp, unsigned char* dp, int w, int h, int r,
+                         const Border& border, int y0, int y1) {
+    MedianHistogram hist(sp, w, h, r, border);
+    int half = (2 * r + 1) * (2 * r + 1) / 2, less, equal;
+    for (int y = y0; y < y1; ++y) {
+        if (y == y0) hist.start_row(y);
+        else hist.next_row(y - 1);
+        hist.start();
+        unsigned char* d = dp + (size_t)y * w;
+        for (int x = 0; x < w; ++x) {
+            if (x > 0) hist.next();
+            d[x] = (unsigned char)hist.rank(half, less, equal);
+        }
+    }
+    if (border.mode == BORDER_COPY) copy_frame(sp, dp, w, h, r, r, y0, y1);
+}
+
+void median_filter(const CImg<unsigned char>& src, CImg<unsigned char>& dst, int r,
+                   const Border& border) {
+    if (r < 0) throw runtime_error("Median radius must be >= 0");
+    check_median_size(2 * r + 1, "Median window");
+    if (&dst == &src) {
+        CImg<unsigned char> tmp;
+        median_filter(src, tmp, r, border);
+        dst.swap(tmp);
+        return;
+    }
+    int w = src.width(), h = src.height(), s = src.spectrum();
+    dst.assign(w, h, 1, s);
+
+    parallel_for_rows(s, h, [&](int c, int y0, int y1) {
+        median_plane(src.data(0, 0, 0, c), dst.data(0, 0, 0, c), w, h, r, border, y0, y1);
+    });
+}
+
+// Levels A and B of the adaptive median at every pixel. Most windows pass
+// level A at the starting size; the rest copy its histogram once and add
+// one ring of pixels per growth step. The median is an extreme exactly when
+// no value is below it or none above, so level A needs one search; level
+// B then only asks whether any value lies beyond the pixel, on the far
+// side from the median.
+static void adaptive_median_plane(const unsigned char* sp, unsigned char* dp, int w, int h,
+                                  int r, int rmax, const Border& border, int y0, int y1) {
+    MedianHistogram hist(sp, w, h, r, border);
+    Border outside(border.mode, outside_value(border));
+    uint16_t coarse[HIST_SEGMENT], fine[256];
+
+    for (int y = y0; y < y1; ++y) {
+        if (y == y0) hist.start_row(y);
+        else hist.next_row(y - 1);
+        hist.start();
+        unsigned char* d = dp + (size_t)y * w;
+        for (int x = 0; x < w; ++x) {
+            if (x > 0) hist.next();
+            int n = (2 * r + 1) * (2 * r + 1), less, equal;
+            int zmed = hist.rank(n / 2, less, equal);
+            bool impulse = less == 0 || less + equal == n;
+
+            // Level A: grow while the median is an extreme
+            bool grown = false;
+            if (impulse && r < rmax) {
+                hist.copy_to(coarse, fine);
+                grown = true;
+                auto add = [&](int px, int py) {
+                    int v = border_fetch(sp, w, h, px, py, outside);
+                    ++coarse[v / HIST_SEGMENT];
+                    ++fine[v];
+                };
+                for (int s = r + 1; s <= rmax && impulse; ++s) {
+                    for (int i = -s; i <= s; ++i) {
+                        add(x + i, y - s);
+                        add(x + i, y + s);
+                    }
+                    for (int i = -s + 1; i < s; ++i) {
+                        add(x - s, y + i);
+                        add(x + s, y + i);
+                    }
+                    n = (2 * s + 1) * (2 * s + 1);
+                    zmed = hist_rank(coarse, fine, n / 2, less, equal);
+                    impulse = less == 0 || less + equal == n;
+                }
+            }
+
+            // Level B: keep the pixel unless it is an extreme itself
+            int z = sp[(size_t)y * w + x];
+            if (impulse || z == zmed) {
+                d[x] = (unsigned char)zmed;
+                continue;
+            }
+            bool above = z > zmed;
+            bool inside = grown ? coarse_beyond(coarse, z / HIST_SEGMENT, above) ||
+                                      fine_beyond(fine, z, above)
+                                : hist.holds_beyond(z, above);
+            d[x] = (unsigned char)(inside ? z : zmed);
+        }
+    }
+    if (border.mode == BORDER_COPY) copy_frame(sp, dp, w, h, r, r, y0, y1);
+}
+
+void adaptive_median(const CImg<unsigned char>& src, CImg<unsigned char>& dst,
+                     int kernelSize, int smax, const Border& border) {
+    check_median_size(kernelSize, "Kernel size");
+    check_median_size(smax, "Smax");
+    if (kernelSize < 3 || smax < kernelSize) {
+        throw runtime_error("Need 3 <= kernel size <= smax");
+    }
+    if (&dst == &src) {
+        CImg<unsigned char> tmp;
+        adaptive_median(src, tmp, kernelSize, smax, border);
+        dst.swap(tmp);
+        return;
+    }
+    int w = src.width(), h = src.height(), s = src.spectrum();
+    dst.assign(w, h, 1, s);
+
+    parallel_for_rows(s, h, [&](int c, int y0, int y1) {
+        adaptive_median_plane(src.data(0, 0, 0, c), dst.data(0, 0, 0, c), w, h,
+                              kernelSize / 2, smax / 2, border, y0, y1);
+    });
+}
+
+CImg<unsigned char> op_adaptive_median(const CImg<unsigned char>& src, int kernelSize, int smax) {
+    CImg<unsigned char> out;
+    adaptive_median(src, out, kernelSize, smax);
+    return out;
+}
@@ -0,0 +1,97 @@
+#ifndef NOISE_FILTERS_H
+#define NOISE_FILTERS_H
+
+#include "Utils.h"
+#include "Border.h"
+#include <cstdint>
+#include <vector>
+
+// Smoothing filters for noise removal. Window sums come from running sums
+// or an integral image, so the cost per pixel does not depend on the
+// window size. Sums are 32-bit: a window may hold up to BOX_MAX_AREA pixels.
+
+const uint32_t BOX_MAX_AREA = UINT32_MAX / 255;
+
+// Mean of the (2 rx + 1) x (2 ry + 1) window around each pixel, rounded.
+// Running column sums move down one row per output row; each row of them
+// is then summed with a running sum along x. dst is resized to match src
+// and keeps its storage when it already fits; it may be src.
+void box_filter(const CImg<unsigned char>& src, CImg<unsigned char>& dst, int rx, int ry,
+                const Border& border = Border(BORDER_CLAMP));
+
+// Same result from an integral image per plane (four lookups per pixel).
+// Slower than box_filter() for one window size, but the table answers
+// any window: see IntegralImage.
+void box_filter_integral(const CImg<unsigned char>& src, CImg<unsigned char>& dst,
+                         int rx, int ry, const Border& border = Border(BORDER_CLAMP));
+
+// Summed-area table of one w x h plane, padded by padX columns and padY
+// rows resolved through a border mode. Entries wrap modulo 2^32, which
+// keeps every window sum below 2^32 exact.
+class IntegralImage {
+public:
+    IntegralImage() : stride_(0), padX_(0), padY_(0) {}
+
+    // Storage is reused across builds
+    void build(const unsigned char* plane, int w, int h, int padX, int padY,
+               const Border& border);
+
+    // Sum over [x0, x1) x [y0, y1), which may reach into the padding
+    uint32_t sum(int x0, int y0, int x1, int y1) const {
+        return row(y1)[x1] - row(y1)[x0] - row(y0)[x1] + row(y0)[x0];
+    }
+
+    // row(y)[x]: sum over [-padX, x) x [-padY, y), for -padX <= x <= w + padX
+    // and -padY <= y <= h + padY
+    const uint32_t* row(int y) const {
+        return &table_[(size_t)(y + padY_) * stride_ + padX_];
+    }
+
+private:
+    int stride_, padX_, padY_;
+    std::vector<uint32_t> table_;
+};
+
+// Gaussian blur approximated by GAUSSIAN_BOX_PASSES box filters in each
+// direction, their widths chosen so the variances add up to sigma^2.
+// Passes run on 8.8 fixed-point rows; the vertical ones are chained so a
+// row goes through all of them while still in cache.
+const int GAUSSIAN_BOX_PASSES = 3;
+const float GAUSSIAN_MAX_SIGMA = 1000;
+
+// Radius of each box pass; throws unless 0 < sigma <= GAUSSIAN_MAX_SIGMA
+void gaussian_box_radii(float sigma, int radii[GAUSSIAN_BOX_PASSES]);
+
+// Sum of the pass radii: how far an output pixel reads
+int gaussian_blur_radius(float sigma);
+
+void gaussian_blur(const CImg<unsigned char>& src, CImg<unsigned char>& dst, float sigma,
+                   const Border& border = Border(BORDER_CLAMP));
+
+// Arithmetic mean over kernelSize x kernelSize (odd), clamped borders
+CImg<unsigned char> op_amean(const CImg<unsigned char>& src, int kernelSize);
+
+// Largest median window edge: window counts stay 16-bit
+const int MEDIAN_MAX_SIZE = 255;
+
+// Median of the (2r + 1) x (2r + 1) window around each pixel, at a cost
+// per pixel that does not depend on r (Perreault and Hebert): histograms
+// of each column's 2r + 1 rows move down a row with one add and one
+// remove, and the window histogram slides along x by adding the entering
+// column's histogram and removing the leaving one's.
+void median_filter(const CImg<unsigned char>& src, CImg<unsigned char>& dst, int r,
+                   const Border& border = Border(BORDER_CLAMP));
+
+// Adaptive median: starting from kernelSize, the window grows by 2 while
+// its median equals its minimum or maximum (an impulse), up to smax; the
+// pixel is kept if it lies strictly between the window's minimum and
+// maximum, otherwise replaced by the median. The kernelSize window is the
+// sliding histogram of median_filter(); larger windows add their outer
+// ring to a copy of it. Both sizes odd, 3 <= kernelSize <= smax <=
+// MEDIAN_MAX_SIZE.
+void adaptive_median(const CImg<unsigned char>& src, CImg<unsigned char>& dst,
+                     int kernelSize, int smax, const Border& border = Border(BORDER_CLAMP));
+
+CImg<unsigned char> op_adaptive_median(const CImg<unsigned char>& src, int kernelSize, int smax);
+
+#endif
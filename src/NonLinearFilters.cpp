@@ -1,29 +1,137 @@
 #include "NonLinearFilters.h"
+#include "Parallel.h"
 #include <iostream>
+#include <stdexcept>
 
 using namespace std;
 
-CImg<unsigned char> rosenfeld_operator(const CImg<unsigned char>& src, int P) {
-    int w = src.width(), h = src.height(), s = src.spectrum();
-    CImg<unsigned char> out(w, h, 1, s);
+// Horizontal Rosenfeld on one plane using a per-row prefix sum over the
+// border-padded row: both P-wide window sums are two lookups, so the cost
+// per pixel does not depend on P.
+static void rosenfeld_plane_h(const unsigned char* sp, unsigned char* dp,
+                              int w, int P, const Border& border,
+                              int y0, int y1) {
+    vector<int> cs(w + 2 * P + 1);
     
-    for (int c = 0; c < s; ++c) {
-        cimg_forXY(src, x, y) {
-            int sum_positive = 0, sum_negative = 0;
-            
-            // Sum from n to n+P-1 (horizontal direction)
-            for (int i = 0; i < P; ++i) {
-                sum_positive += getp(src, x + i, y, c);
+    for (int y = y0; y < y1; ++y) {
+        const unsigned char* p = sp + (size_t)y * w;
+        unsigned char* d = dp + (size_t)y * w;
+        
+        // cs[i + 1] = sum of padded row up to padded index i (x = i - P)
+        cs[0] = 0;
+        for (int i = 0; i < w + 2 * P; ++i) {
+            int x = i - P;
+            int v;
+            if (x >= 0 && x < w) {
+                v = p[x];
+            } else {
+                int bx = border_index(x, w, border.mode);
+                v = bx < 0 ? border.value : p[bx];
             }
-            
-            // Sum from n-P to n-1
-            for (int i = 1; i <= P; ++i) {
-                sum_negative += getp(src, x - i, y, c);
+            cs[i + 1] = cs[i] + v;
+        }
+        
+        for (int x = 0; x < w; ++x) {
+            // Sum from n to n+P-1 and from n-P to n-1
+            int sum_positive = cs[x + 2 * P] - cs[x + P];
+            int sum_negative = cs[x + P] - cs[x];
+            d[x] = (unsigned char)clampv(abs(sum_positive - sum_negative) / P, 0, 255);
+        }
+        
+        if (border.mode == BORDER_COPY) {
+            for_each_frame_pixel(w, 1, P, 0, [&](int x, int) { d[x] = p[x]; });
+        }
+    }
+}
+
+// Vertical Rosenfeld on one plane with running column sums: moving down one
+// row adds the entering row and subtracts the leaving one for both windows.
+// When combine is set the result is max-merged into dp instead of stored.
+static void rosenfeld_plane_v(const unsigned char* sp, unsigned char* dp,
+                              int w, int h, int P, const Border& border,
+                              int y0, int y1, bool combine) {
+    vector<int> constant_row(w, border.value);
+    vector<int> pos(w, 0), neg(w, 0);
+    
+    // Row y resolved through the border mode; CONSTANT rows use border.value
+    auto add_row = [&](vector<int>& acc, int y, int sign) {
+        int by = border_index(y, h, border.mode);
+        if (by < 0) {
+            for (int x = 0; x < w; ++x) acc[x] += sign * constant_row[x];
+            return;
+        }
+        const unsigned char* r = sp + (size_t)by * w;
+        for (int x = 0; x < w; ++x) acc[x] += sign * r[x];
+    };
+    
+    for (int i = 0; i < P; ++i) add_row(pos, y0 + i, 1);
+    for (int i = 1; i <= P; ++i) add_row(neg, y0 - i, 1);
+    
+    for (int y = y0; y < y1; ++y) {
+        const unsigned char* s = sp + (size_t)y * w;
+        unsigned char* d = dp + (size_t)y * w;
+        bool copy = border.mode == BORDER_COPY && (y < P || y >= h - P);
+        for (int x = 0; x < w; ++x) {
+            if (copy) {
+                d[x] = s[x];
+                continue;
             }
-            
-            int diff = abs(sum_positive - sum_negative) / P;
-            out(x, y, c) = (unsigned char)clampv(diff, 0, 255);
+            int v = clampv(abs(pos[x] - neg[x]) / P, 0, 255);
+            d[x] = combine ? max<int>(d[x], v) : v;
+        }
+        // The copied frame is the union of both passes' frames: the merge
+        // must not touch the horizontal pass's copied columns either
+        if (combine && border.mode == BORDER_COPY && !copy) {
+            for_each_frame_pixel(w, 1, P, 0, [&](int x, int) { d[x] = s[x]; });
         }
+
+        // Slide both windows down by one row
+        add_row(pos, y + P, 1);
+        add_row(pos, y, -1);
+        add_row(neg, y, 1);
+        add_row(neg, y - P, -1);
+    }
+}
+
+void rosenfeld_operator(const CImg<unsigned char>& src, CImg<unsigned char>& out,
+                        int P, const Border& border, RosenfeldDirection direction) {
+    if (P < 1) throw runtime_error("Rosenfeld P must be >= 1");
+    if (&out == &src) {
+        CImg<unsigned char> tmp;
+        rosenfeld_operator(src, tmp, P, border, direction);
+        out.swap(tmp);
+        return;
     }
+    int w = src.width(), h = src.height(), s = src.spectrum();
+    out.assign(w, h, 1, s);
+    
+    parallel_for_rows(s, h, [&](int c, int y0, int y1) {
+        const unsigned char* sp = src.data(0, 0, 0, c);
+        unsigned char* dp = out.data(0, 0, 0, c);
+        
+        if (direction == ROSENFELD_VERTICAL) {
+            rosenfeld_plane_v(sp, dp, w, h, P, border, y0, y1, false);
+        } else {
+            rosenfeld_plane_h(sp, dp, w, P, border, y0, y1);
+            if (direction == ROSENFELD_BOTH) {
+                rosenfeld_plane_v(sp, dp, w, h, P, border, y0, y1, true);
+            }
+        }
+    });
+}
+
+CImg<unsigned char> rosenfeld_operator(const CImg<unsigned char>& src, int P,
+                                      const Border& border,
+                                      RosenfeldDirection direction) {
+    CImg<unsigned char> out;
+    rosenfeld_operator(src, out, P, border, direction);
     return out;
 }
+
+bool parse_rosenfeld_direction(const string& name, RosenfeldDirection& direction) {
+    if (name == "horizontal" || name == "h")    direction = ROSENFELD_HORIZONTAL;
+    else if (name == "vertical" || name == "v") direction = ROSENFELD_VERTICAL;
+    else if (name == "both" || name == "hv")    direction = ROSENFELD_BOTH;
+    else return false;
+    return true;
+}
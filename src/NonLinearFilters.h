@@ -2,8 +2,27 @@
 #define NONLINEAR_FILTERS_H
 
 #include "Utils.h"
+#include "Border.h"
+
+// Window pair orientation for the Rosenfeld operator
+enum RosenfeldDirection {
+    ROSENFELD_HORIZONTAL,  // Windows left/right of the pixel (original O5)
+    ROSENFELD_VERTICAL,    // Windows above/below the pixel
+    ROSENFELD_BOTH         // Max of the horizontal and vertical responses
+};
+
+// Parse "horizontal"/"h", "vertical"/"v" or "both"/"hv"
+bool parse_rosenfeld_direction(const std::string& name, RosenfeldDirection& direction);
 
 // O5: Rosenfeld operator
-CImg<unsigned char> rosenfeld_operator(const CImg<unsigned char>& src, int P = 1);
+// Running sums make the cost per pixel independent of P
+CImg<unsigned char> rosenfeld_operator(const CImg<unsigned char>& src, int P = 1,
+                                      const Border& border = Border(BORDER_CLAMP),
+                                      RosenfeldDirection direction = ROSENFELD_HORIZONTAL);
+
+// Same, writing into dst (storage reused when it already fits; may be src)
+void rosenfeld_operator(const CImg<unsigned char>& src, CImg<unsigned char>& dst,
+                        int P = 1, const Border& border = Border(BORDER_CLAMP),
+                        RosenfeldDirection direction = ROSENFELD_HORIZONTAL);
 
 #endif
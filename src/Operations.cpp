@@ -0,0 +1,48 @@
+#include "Operations.h"
+#include <cmath>
+#include <unistd.h>
+
+using namespace std;
+
+string resolveAbsolutePath(const string& path) {
+    if (path.empty() || path[0] == '/') return path;
+    char cwd[4096];
+    if (!getcwd(cwd, sizeof(cwd))) return path;
+    return string(cwd) + "/" + path;
+}
+
+void saveAsBMP(const CImg<unsigned char>& img, const string& path) {
+    img.save_bmp(path.c_str());
+}
+
+// dst(x, y, c) = fn(c, src(x, y, c)), clamped
+template <typename Fn>
+static CImg<unsigned char> map_pixels(const CImg<unsigned char>& src, Fn fn) {
+    CImg<unsigned char> dst(src.width(), src.height(), 1, src.spectrum());
+    size_t plane = (size_t)src.width() * src.height();
+    for (int c = 0; c < src.spectrum(); ++c) {
+        const unsigned char* s = src.data(0, 0, 0, c);
+        unsigned char* d = dst.data(0, 0, 0, c);
+        for (size_t i = 0; i < plane; ++i) d[i] = (unsigned char)clampv(fn(c, s[i]), 0, 255);
+    }
+    return dst;
+}
+
+CImg<unsigned char> op_brightness(const CImg<unsigned char>& src, int value) {
+    return map_pixels(src, [value](int, int v) { return v + value; });
+}
+
+CImg<unsigned char> op_contrast_linear(const CImg<unsigned char>& src, float factor) {
+    return map_pixels(src, [factor](int, int v) {
+        return (int)lround((v - 128) * factor + 128);
+    });
+}
+
+CImg<unsigned char> op_negative(const CImg<unsigned char>& src) {
+    return map_pixels(src, [](int, int v) { return 255 - v; });
+}
+
+CImg<unsigned char> op_rgb_add(const CImg<unsigned char>& src, int rAdd, int gAdd, int bAdd) {
+    const int add[3] = { rAdd, gAdd, bAdd };
+    return map_pixels(src, [&add](int c, int v) { return c < 3 ? v + add[c] : v; });
+}
@@ -0,0 +1,31 @@
+#ifndef OPERATIONS_H
+#define OPERATIONS_H
+
+#include "Utils.h"
+#include <string>
+
+// File helpers and per-pixel adjustments used by ImageProcessor. The ops
+// return a new image of the same size; values are clamped to [0, 255].
+
+// path made absolute against the working directory (kept if it already is)
+std::string resolveAbsolutePath(const std::string& path);
+
+// Save img as a 24-bit (or 8-bit gray) BMP whatever the extension;
+// throws CImgException on failure
+void saveAsBMP(const CImg<unsigned char>& img, const std::string& path);
+
+inline bool isOdd(int n) { return n % 2 != 0; }
+
+// v + value
+CImg<unsigned char> op_brightness(const CImg<unsigned char>& src, int value);
+
+// (v - 128) * factor + 128, rounded
+CImg<unsigned char> op_contrast_linear(const CImg<unsigned char>& src, float factor);
+
+// 255 - v
+CImg<unsigned char> op_negative(const CImg<unsigned char>& src);
+
+// v + rAdd, gAdd or bAdd on channels 0, 1 and 2; other channels unchanged
+CImg<unsigned char> op_rgb_add(const CImg<unsigned char>& src, int rAdd, int gAdd, int bAdd);
+
+#endif
@@ -0,0 +1,166 @@
+#include "Parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Minimum rows per band, so tiny images do not pay for scheduling
+static const int MIN_BAND_ROWS = 16;
+
+namespace {
+
+class ThreadPool {
+public:
+    explicit ThreadPool(int workers) : job(nullptr), tasks(0), next(0),
+                                       active(0), generation(0), stop(false) {
+        for (int i = 0; i < workers; ++i) {
+            threads.emplace_back(&ThreadPool::worker_loop, this);
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lock(m);
+            stop = true;
+        }
+        cv_start.notify_all();
+        for (auto& t : threads) t.join();
+    }
+
+    int size() const { return threads.size() + 1; }
+
+    void run(int n, const function<void(int)>& fn) {
+        {
+            lock_guard<mutex> lock(m);
+            job = &fn;
+            tasks = n;
+            next = 0;
+            active = threads.size();
+            error = nullptr;
+            ++generation;
+        }
+        cv_start.notify_all();
+        drain(fn, n);
+
+        unique_lock<mutex> lock(m);
+        cv_done.wait(lock, [this] { return active == 0; });
+        job = nullptr;
+        if (error) rethrow_exception(error);
+    }
+
+private:
+    void drain(const function<void(int)>& fn, int n) {
+        for (int i = next++; i < n; i = next++) {
+            try {
+                fn(i);
+            } catch (...) {
+                lock_guard<mutex> lock(m);
+                if (!error) error = current_exception();
+                next = n;  // Abandon the remaining tasks
+            }
+        }
+    }
+
+    void worker_loop();
+
+    vector<thread> threads;
+    mutex m;
+    condition_variable cv_start, cv_done;
+    const function<void(int)>* job;
+    int tasks;
+    atomic<int> next;
+    int active;
+    unsigned long generation;
+    bool stop;
+    exception_ptr error;
+};
+
+// Set on pool threads so nested parallel_for calls run inline
+thread_local bool tls_in_pool = false;
+
+void ThreadPool::worker_loop() {
+    tls_in_pool = true;
+    unsigned long seen = 0;
+    for (;;) {
+        const function<void(int)>* fn;
+        int n;
+        {
+            unique_lock<mutex> lock(m);
+            cv_start.wait(lock, [&] { return stop || generation != seen; });
+            if (stop) return;
+            seen = generation;
+            fn = job;
+            n = tasks;
+        }
+        drain(*fn, n);
+        {
+            lock_guard<mutex> lock(m);
+            if (--active == 0) cv_done.notify_one();
+        }
+    }
+}
+
+} // namespace
+
+static int& requested_threads() {
+    static int n = max(1u, thread::hardware_concurrency());
+    return n;
+}
+
+static mutex pool_mutex;
+static unique_ptr<ThreadPool> pool;
+
+void set_thread_count(int n) {
+    lock_guard<mutex> lock(pool_mutex);
+    requested_threads() = max(1, n);
+    pool.reset();  // Recreated lazily with the new size
+}
+
+int thread_count() {
+    return requested_threads();
+}
+
+void parallel_for(int tasks, const function<void(int)>& body) {
+    if (tasks <= 0) return;
+
+    unique_lock<mutex> lock(pool_mutex, defer_lock);
+    bool inline_run = tasks == 1 || requested_threads() == 1 ||
+                      tls_in_pool || !lock.try_lock();
+    if (inline_run) {
+        for (int i = 0; i < tasks; ++i) body(i);
+        return;
+    }
+
+    if (!pool) pool.reset(new ThreadPool(requested_threads() - 1));
+    tls_in_pool = true;
+    try {
+        pool->run(tasks, body);
+    } catch (...) {
+        tls_in_pool = false;
+        throw;
+    }
+    tls_in_pool = false;
+}
+
+void parallel_for_rows(int channels, int rows,
+                       const function<void(int, int, int)>& body) {
+    if (channels <= 0 || rows <= 0) return;
+
+    // Aim for ~4 bands per thread across all channels for load balance
+    int threads = requested_threads();
+    int per_channel = max(1, (4 * threads + channels - 1) / channels);
+    int band = max(MIN_BAND_ROWS, (rows + per_channel - 1) / per_channel);
+    int bands = (rows + band - 1) / band;
+
+    parallel_for(channels * bands, [&](int i) {
+        int c = i / bands;
+        int y0 = (i % bands) * band;
+        body(c, y0, min(rows, y0 + band));
+    });
+}
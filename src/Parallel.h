@@ -0,0 +1,22 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <functional>
+
+// Row-parallel execution on a persistent thread pool. The calling thread
+// takes part in the work, so -threads=1 runs everything inline.
+
+// Total threads used by parallel_for (default: hardware concurrency)
+void set_thread_count(int n);
+int thread_count();
+
+// Run body(i) for every i in [0, tasks); returns when all have finished.
+// Nested calls, and calls made while another thread owns the pool, run
+// inline on the caller. The first exception thrown by body is rethrown.
+void parallel_for(int tasks, const std::function<void(int)>& body);
+
+// Split channels x rows into row bands and run body(c, y0, y1) on them
+void parallel_for_rows(int channels, int rows,
+                       const std::function<void(int, int, int)>& body);
+
+#endif
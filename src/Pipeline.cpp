@@ -0,0 +1,209 @@
+#include "Pipeline.h"
+#include "NoiseFilters.h"
+#include "Parallel.h"
+#include "Profile.h"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+// Target size of one haloed tile buffer (all channels); two of them per
+// thread should stay resident in L2
+static const size_t FUSED_TILE_BYTES = 192 * 1024;
+
+static vector<string> split(const string& s, char sep) {
+    vector<string> parts;
+    string part;
+    istringstream in(s);
+    while (getline(in, part, sep)) parts.push_back(part);
+    if (!s.empty() && s.back() == sep) parts.push_back("");
+    return parts;
+}
+
+vector<CommandOptions> parse_pipeline(const string& spec, const CommandOptions& base) {
+    vector<CommandOptions> stages;
+    for (const string& stageSpec : split(spec, ',')) {
+        vector<string> parts = split(stageSpec, ':');
+        if (parts.empty() || parts[0].empty()) {
+            throw runtime_error("Empty stage in pipeline: " + spec);
+        }
+        if (parts[0] == "pipeline") {
+            throw runtime_error("Pipelines cannot be nested");
+        }
+
+        CommandOptions stage = base;
+        stage.command = "--" + parts[0];
+        if (!command_writes_image(stage.command) && stage.command != "--histogram" &&
+            stage.command != "--characteristics") {
+            throw runtime_error("Unknown pipeline stage: " + parts[0]);
+        }
+        stage.outputPath.clear();
+        for (size_t i = 1; i < parts.size(); ++i) {
+            string error;
+            if (!parse_option("-" + parts[i], stage, error)) {
+                throw runtime_error("Stage " + parts[0] + ": " + error);
+            }
+        }
+        stages.push_back(stage);
+    }
+    return stages;
+}
+
+bool stage_radius(const CommandOptions& stage, int& rx, int& ry) {
+    // Wrap reads from the opposite edge, which a tile does not contain
+    if (stage.borderSet && stage.border.mode == BORDER_WRAP) return false;
+
+    if (stage.command == "--sedgesharp") {
+        rx = ry = 1;
+        return true;
+    }
+    if (stage.command == "--orosenfeld") {
+        rx = stage.direction == ROSENFELD_VERTICAL ? 0 : stage.P;
+        ry = stage.direction == ROSENFELD_HORIZONTAL ? 0 : stage.P;
+        return true;
+    }
+    if (stage.command == "--amean") {
+        rx = ry = stage.kernelSize / 2;
+        return true;
+    }
+    if (stage.command == "--median") {
+        rx = ry = stage.kernelSize / 2;
+        return true;
+    }
+    if (stage.command == "--amedian") {
+        rx = ry = max(stage.kernelSize, stage.smax) / 2;
+        return true;
+    }
+    if (stage.command == "--gaussian") {
+        rx = ry = gaussian_blur_radius(stage.sigma);
+        return true;
+    }
+    return false;
+}
+
+// Copy rows [y0, y1) x columns [x0, x1) of every channel into dst
+static void crop_into(const CImg<unsigned char>& src, CImg<unsigned char>& dst,
+                      int x0, int y0, int x1, int y1) {
+    dst.assign(x1 - x0, y1 - y0, 1, src.spectrum());
+    for (int c = 0; c < src.spectrum(); ++c) {
+        for (int y = y0; y < y1; ++y) {
+            memcpy(dst.data(0, y - y0, 0, c), src.data(x0, y, 0, c), x1 - x0);
+        }
+    }
+}
+
+void run_fused_stages(const vector<CommandOptions>& stages,
+                      const CImg<unsigned char>& src, CImg<unsigned char>& dst) {
+    int w = src.width(), h = src.height(), s = src.spectrum();
+    int haloX = 0, haloY = 0;
+    for (const CommandOptions& stage : stages) {
+        int rx, ry;
+        if (!stage_radius(stage, rx, ry)) {
+            throw runtime_error("Stage " + stage.command + " cannot be tile-fused");
+        }
+        haloX += rx;
+        haloY += ry;
+    }
+
+    // Tiles span up to 512 columns and as many rows as keep one
+    // haloed tile buffer near FUSED_TILE_BYTES
+    int tileW = min(w, 512);
+    int rowBytes = (tileW + 2 * haloX) * s;
+    int tileH = max(16, (int)(FUSED_TILE_BYTES / rowBytes) - 2 * haloY);
+    tileH = min(tileH, h);
+    int cols = (w + tileW - 1) / tileW, rows = (h + tileH - 1) / tileH;
+
+    ostream discard(nullptr);  // Stage messages would repeat per tile
+    ostringstream noReport;
+
+    // A single tile would only serialize the filters' own row parallelism
+    if (cols * rows == 1) {
+        CImg<unsigned char> tmp;
+        const CImg<unsigned char>* cur = &src;
+        for (const CommandOptions& stage : stages) {
+            CImg<unsigned char>& out = cur == &dst ? tmp : dst;
+            run_command(stage, *cur, "", "", out, noReport, discard);
+            cur = &out;
+        }
+        if (cur == &tmp) dst.swap(tmp);
+        return;
+    }
+
+    dst.assign(w, h, 1, s);
+
+    parallel_for(cols * rows, [&](int t) {
+        int tx = (t % cols) * tileW, ty = (t / cols) * tileH;
+        int tx1 = min(w, tx + tileW), ty1 = min(h, ty + tileH);
+
+        // Input window: the tile plus the accumulated halo, clipped to the
+        // image. Where it is clipped, the window edge is the image edge and
+        // the stages' border modes apply exactly as on the whole image;
+        // elsewhere errors stay inside the halo that is discarded below.
+        int x0 = max(0, tx - haloX), y0 = max(0, ty - haloY);
+        int x1 = min(w, tx1 + haloX), y1 = min(h, ty1 + haloY);
+
+        // Per-thread buffers stay warm in cache across tiles
+        static thread_local CImg<unsigned char> buf[2];
+        crop_into(src, buf[0], x0, y0, x1, y1);
+        int cur = 0;
+        for (const CommandOptions& stage : stages) {
+            run_command(stage, buf[cur], "", "", buf[1 - cur], noReport, discard);
+            cur = 1 - cur;
+        }
+
+        const CImg<unsigned char>& out = buf[cur];
+        for (int c = 0; c < s; ++c) {
+            for (int y = ty; y < ty1; ++y) {
+                memcpy(dst.data(tx, y, 0, c), out.data(tx - x0, y - y0, 0, c), tx1 - tx);
+            }
+        }
+    });
+}
+
+void run_pipeline(const CommandOptions& opts, const CImg<unsigned char>& img,
+                  const string& inputPath, const string& outputPath,
+                  CImg<unsigned char>& result, ostream& report, ostream& log) {
+    (void)outputPath;  // The caller saves the final image
+    vector<CommandOptions> stages = parse_pipeline(opts.command.substr(11), opts);
+
+    CImg<unsigned char> scratch, unused;
+    const CImg<unsigned char>* current = &img;
+
+    for (size_t i = 0; i < stages.size(); ++i) {
+        const CommandOptions& stage = stages[i];
+        if (!command_writes_image(stage.command)) {
+            ProfileScope scope(command_stage_name(stage.command));
+            run_command(stage, *current, inputPath, stage.outputPath, unused, report, log);
+            scope.counts(current->size(), 0, (uint64_t)current->width() * current->height());
+            continue;
+        }
+        // Write into whichever buffer the current image is not in
+        CImg<unsigned char>& dst = current == &result ? scratch : result;
+
+        // Runs of two or more neighbourhood filters go tile by tile
+        size_t end = i;
+        int rx, ry;
+        while (opts.fuse && end < stages.size() && stage_radius(stages[end], rx, ry)) ++end;
+        if (end - i >= 2) {
+            vector<CommandOptions> run(stages.begin() + i, stages.begin() + end);
+            string names;
+            for (const auto& r : run) names += (names.empty() ? "" : "+") + command_stage_name(r.command);
+            ProfileScope scope("fused(" + names + ")");
+            run_fused_stages(run, *current, dst);
+            scope.counts(current->size(), dst.size(), (uint64_t)current->width() * current->height());
+            log << "Applied " << run.size() << " fused stages:";
+            for (const auto& r : run) log << " " << r.command.substr(2);
+            log << "\n";
+            i = end - 1;
+        } else {
+            ProfileScope scope(command_stage_name(stage.command));
+            run_command(stage, *current, inputPath, stage.outputPath, dst, report, log);
+            scope.counts(current->size(), dst.size(), (uint64_t)current->width() * current->height());
+        }
+        current = &dst;
+    }
+
+    if (current == &scratch) result.swap(scratch);
+}
@@ -0,0 +1,38 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "Commands.h"
+#include <vector>
+
+// Chained commands run in memory on one decoded image, e.g.
+//   --pipeline=sedgesharp:variant=2,hpower:gmin=10,characteristics
+// Stages are separated by ',', parameters by ':'. Each parameter is an
+// ordinary option without its leading '-' ("optimized" for flags).
+// A stage's output= names its own file (histogram plot, report); it
+// does not inherit the pipeline's -output=.
+
+// Options of every stage: base plus the stage's own parameters.
+// Throws on empty or nested stages and malformed parameters.
+std::vector<CommandOptions> parse_pipeline(const std::string& spec,
+                                           const CommandOptions& base);
+
+// Halo a stage needs around each output pixel; false if the stage cannot
+// be tile-fused (not a bounded neighbourhood filter, or wrap borders)
+bool stage_radius(const CommandOptions& stage, int& rx, int& ry);
+
+// Run neighbourhood stages back to back on cache-sized tiles with the
+// summed halo, tiles spread over the thread pool. Same output as running
+// the stages one after another on the whole image.
+void run_fused_stages(const std::vector<CommandOptions>& stages,
+                      const CImg<unsigned char>& src, CImg<unsigned char>& dst);
+
+// Run the stages of opts.command ("--pipeline=...") on img. Image stages
+// ping-pong between result and one scratch buffer, so the chain allocates
+// at most two images however long it is; result holds the last image.
+// Consecutive neighbourhood filters are tile-fused unless opts.fuse is off.
+void run_pipeline(const CommandOptions& opts, const CImg<unsigned char>& img,
+                  const std::string& inputPath, const std::string& outputPath,
+                  CImg<unsigned char>& result, std::ostream& report,
+                  std::ostream& log);
+
+#endif
@@ -0,0 +1,154 @@
+#include "Profile.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <map>
+#include <mutex>
+
+using namespace std;
+
+static atomic<bool> enabled(false);
+static mutex log_mutex;
+static vector<ProfileRecord> process_log;
+
+static thread_local int scope_depth = 0;
+
+static double now_us() {
+    static const chrono::steady_clock::time_point origin = chrono::steady_clock::now();
+    return chrono::duration<double, micro>(chrono::steady_clock::now() - origin).count();
+}
+
+static double process_cpu_ms() {
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static int thread_id() {
+    static atomic<int> next(0);
+    static thread_local int id = next++;
+    return id;
+}
+
+void set_profiling(bool on) {
+    enabled = on;
+}
+
+bool profiling() {
+    return enabled;
+}
+
+ProfileScope::ProfileScope(const string& stage, vector<ProfileRecord>* sink)
+    : active_(sink || enabled), sink_(sink), cpuStartMs_(0) {
+    if (!active_) return;
+    record_.stage = stage;
+    record_.depth = scope_depth++;
+    record_.thread = thread_id();
+    record_.bytesRead = record_.bytesWritten = record_.pixels = 0;
+    cpuStartMs_ = process_cpu_ms();
+    record_.startUs = now_us();
+}
+
+ProfileScope::~ProfileScope() {
+    if (!active_) return;
+    record_.wallMs = (now_us() - record_.startUs) / 1000;
+    record_.cpuMs = process_cpu_ms() - cpuStartMs_;
+    --scope_depth;
+    if (sink_) {
+        sink_->push_back(record_);
+        return;
+    }
+    lock_guard<mutex> lock(log_mutex);
+    process_log.push_back(record_);
+}
+
+void ProfileScope::counts(uint64_t bytesRead, uint64_t bytesWritten, uint64_t pixels) {
+    record_.bytesRead = bytesRead;
+    record_.bytesWritten = bytesWritten;
+    record_.pixels = pixels;
+}
+
+vector<ProfileRecord> profile_records() {
+    lock_guard<mutex> lock(log_mutex);
+    return process_log;
+}
+
+void write_profile_table(ostream& os, const vector<ProfileRecord>& records) {
+    // Records complete children first; order stages by start instead
+    struct Total {
+        string stage;
+        int depth;
+        double firstUs;
+        int calls;
+        double wallMs, cpuMs;
+        uint64_t bytesRead, bytesWritten, pixels;
+    };
+    vector<Total> totals;
+    map<pair<int, string>, size_t> index;
+    for (const ProfileRecord& r : records) {
+        auto key = make_pair(r.depth, r.stage);
+        auto it = index.find(key);
+        if (it == index.end()) {
+            it = index.insert(make_pair(key, totals.size())).first;
+            totals.push_back({ r.stage, r.depth, r.startUs, 0, 0, 0, 0, 0, 0 });
+        }
+        Total& t = totals[it->second];
+        t.firstUs = min(t.firstUs, r.startUs);
+        ++t.calls;
+        t.wallMs += r.wallMs;
+        t.cpuMs += r.cpuMs;
+        t.bytesRead += r.bytesRead;
+        t.bytesWritten += r.bytesWritten;
+        t.pixels += r.pixels;
+    }
+    stable_sort(totals.begin(), totals.end(),
+                [](const Total& a, const Total& b) { return a.firstUs < b.firstUs; });
+
+    os << "Profile:\n" << left << setw(32) << "  stage" << right << setw(7) << "calls"
+       << setw(11) << "wall ms" << setw(11) << "cpu ms" << setw(10) << "MB in"
+       << setw(10) << "MB out" << setw(9) << "MPix" << setw(10) << "MPix/s" << "\n";
+    double totalWall = 0, totalCpu = 0;
+    ios::fmtflags flags = os.flags();
+    os << fixed;
+    for (const Total& t : totals) {
+        if (t.depth == 0) {
+            totalWall += t.wallMs;
+            totalCpu += t.cpuMs;
+        }
+        double mpix = t.pixels / 1e6;
+        os << left << setw(32) << string(2 + 2 * t.depth, ' ') + t.stage << right
+           << setw(7) << t.calls << setprecision(2) << setw(11) << t.wallMs << setw(11)
+           << t.cpuMs << setw(10) << t.bytesRead / 1e6 << setw(10) << t.bytesWritten / 1e6
+           << setw(9) << mpix << setprecision(1) << setw(10)
+           << (t.wallMs > 0 ? mpix / (t.wallMs / 1000) : 0.0) << "\n";
+    }
+    os << left << setw(32) << "  total" << right << setw(7) << "" << setprecision(2)
+       << setw(11) << totalWall << setw(11) << totalCpu << "\n";
+    os.flags(flags);
+}
+
+static string json_escape(const string& s) {
+    string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        if ((unsigned char)c >= 0x20) out += c;
+    }
+    return out;
+}
+
+void write_chrome_trace(ostream& os, const vector<ProfileRecord>& records) {
+    ios::fmtflags flags = os.flags();
+    os << fixed << setprecision(3) << "{\"traceEvents\": [\n";
+    for (size_t i = 0; i < records.size(); ++i) {
+        const ProfileRecord& r = records[i];
+        os << "{\"name\": \"" << json_escape(r.stage) << "\", \"cat\": \"stage\", \"ph\": \"X\", "
+           << "\"ts\": " << r.startUs << ", \"dur\": " << r.wallMs * 1000
+           << ", \"pid\": 1, \"tid\": " << r.thread << ", \"args\": {\"cpu_ms\": " << r.cpuMs
+           << ", \"bytes_read\": " << r.bytesRead << ", \"bytes_written\": " << r.bytesWritten
+           << ", \"pixels\": " << r.pixels << "}}" << (i + 1 < records.size() ? "," : "") << "\n";
+    }
+    os << "],\n\"displayTimeUnit\": \"ms\"}\n";
+    os.flags(flags);
+}
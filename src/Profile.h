@@ -0,0 +1,57 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Opt-in stage timing (-profile). A ProfileScope around a stage (decode,
+// one op, encode) records its wall time, the process CPU time spent
+// meanwhile (so pool threads count too) and the bytes and pixels it
+// handled. Scopes nest; a stage's record includes its children.
+
+struct ProfileRecord {
+    std::string stage;
+    int depth;              // 0 for top-level stages
+    int thread;             // Small id of the recording thread
+    double startUs;         // Since the first scope of the process
+    double wallMs, cpuMs;
+    uint64_t bytesRead, bytesWritten, pixels;
+};
+
+// Process-wide switch; while off, scopes without a sink record nothing
+void set_profiling(bool on);
+bool profiling();
+
+class ProfileScope {
+public:
+    // Records into sink if given (whether or not profiling is on), else
+    // into the process-wide log when profiling() is on
+    explicit ProfileScope(const std::string& stage, std::vector<ProfileRecord>* sink = nullptr);
+    ~ProfileScope();
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+    void counts(uint64_t bytesRead, uint64_t bytesWritten, uint64_t pixels);
+
+private:
+    bool active_;
+    std::vector<ProfileRecord>* sink_;
+    ProfileRecord record_;
+    double cpuStartMs_;
+};
+
+// Copy of the process-wide log, in order of completion
+std::vector<ProfileRecord> profile_records();
+
+// Totals per stage (first-seen order, children indented under parents):
+// calls, wall and CPU ms, MB read and written, MPix and MPix/s
+void write_profile_table(std::ostream& os, const std::vector<ProfileRecord>& records);
+
+// Chrome trace-event JSON (chrome://tracing, Perfetto): one complete
+// event per record, counters in its args
+void write_chrome_trace(std::ostream& os, const std::vector<ProfileRecord>& records);
+
+#endif
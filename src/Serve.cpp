@@ -0,0 +1,345 @@
+#include "Serve.h"
+#include "BmpStream.h"
+#include "Interleaved.h"
+#include "MappedBmp.h"
+#include "Parallel.h"
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+// Longest accepted request line, and largest -data= payload
+static const size_t MAX_REQUEST_LINE = 64 * 1024;
+static const size_t MAX_REQUEST_DATA = (size_t)1 << 31;
+
+// Input still read and dropped after rejecting an oversized line
+static const size_t MAX_REQUEST_DISCARD = 16 * MAX_REQUEST_LINE;
+
+namespace {
+
+// Buffered reads and whole writes on one client socket
+class Connection {
+public:
+    explicit Connection(int fd) : fd_(fd), begin_(0), end_(0), buf_(64 * 1024) {}
+    ~Connection() { close(fd_); }
+
+    // false at end of stream; throws on oversized lines
+    bool read_line(string& line) {
+        line.clear();
+        for (;;) {
+            for (size_t i = begin_; i < end_; ++i) {
+                if (buf_[i] != '\n') continue;
+                line.append(&buf_[begin_], i - begin_);
+                begin_ = i + 1;
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                return true;
+            }
+            line.append(&buf_[begin_], end_ - begin_);
+            begin_ = end_ = 0;
+            if (line.size() > MAX_REQUEST_LINE) throw runtime_error("Request line too long");
+            if (!fill()) return false;
+        }
+    }
+
+    bool read_exact(unsigned char* dst, size_t n) {
+        while (n > 0) {
+            if (begin_ == end_ && !fill()) return false;
+            size_t take = min(n, end_ - begin_);
+            memcpy(dst, &buf_[begin_], take);
+            begin_ += take;
+            dst += take;
+            n -= take;
+        }
+        return true;
+    }
+
+    bool write_all(const void* data, size_t n) {
+        const char* p = (const char*)data;
+        while (n > 0) {
+            ssize_t sent = write(fd_, p, n);
+            if (sent < 0 && errno == EINTR) continue;
+            if (sent <= 0) return false;
+            p += sent;
+            n -= sent;
+        }
+        return true;
+    }
+
+    // Stop writing, and read and drop what the client is still sending
+    // (up to limit bytes), so a reply already sent is not lost to a reset
+    void finish(size_t limit) {
+        shutdown(fd_, SHUT_WR);
+        begin_ = end_ = 0;
+        for (size_t dropped = 0; dropped < limit && fill(); dropped += end_) {}
+    }
+
+private:
+    bool fill() {
+        for (;;) {
+            ssize_t got = read(fd_, buf_.data(), buf_.size());
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) return false;
+            begin_ = 0;
+            end_ = got;
+            return true;
+        }
+    }
+
+    int fd_;
+    size_t begin_, end_;
+    vector<char> buf_;
+};
+
+// Buffers kept by a worker across requests and connections
+struct WorkerState {
+    MappedBmp bmp;
+    CImg<unsigned char> img, result;
+    vector<unsigned char> data;
+};
+
+struct Request {
+    CommandOptions opts;
+    size_t dataBytes = 0;
+    bool returnImage = false;  // -output=-
+};
+
+}  // namespace
+
+static int listen_fd = -1;
+static atomic<bool> stopping(false);
+
+static vector<string> split_arguments(const string& line) {
+    vector<string> args;
+    istringstream in(line);
+    string arg;
+    while (in >> arg) args.push_back(arg);
+    return args;
+}
+
+// Options of a request line; the image payload is read by the caller
+static Request parse_request(const vector<string>& args) {
+    Request req;
+    for (const string& arg : args) {
+        string error;
+        if (arg.find("--") == 0) {
+            req.opts.command = arg;
+        }
+        else if (arg.find("-data=") == 0) {
+            long long n = atoll(arg.c_str() + 6);
+            if (n <= 0 || (size_t)n > MAX_REQUEST_DATA) throw runtime_error("Invalid " + arg);
+            req.dataBytes = (size_t)n;
+        }
+        else if (arg.find("-batch=") == 0 || arg == "-stream" || arg.find("-threads=") == 0) {
+            throw runtime_error(arg.substr(0, arg.find('=')) + " is not available in --serve requests");
+        }
+        else if (!parse_option(arg, req.opts, error)) {
+            throw runtime_error(error);
+        }
+    }
+    if (req.opts.command.empty()) throw runtime_error("No command in request");
+    if (req.opts.outputPath == "-") {
+        if (req.opts.command == "--histogram") {
+            throw runtime_error("--histogram needs an output file");
+        }
+        req.returnImage = command_writes_image(req.opts.command);
+        req.opts.outputPath.clear();  // --characteristics then reports inline
+    }
+    return req;
+}
+
+// BMP file bytes CImg decodes (the formats MappedBmp does not take)
+static void decode_bmp(const vector<unsigned char>& data, CImg<unsigned char>& img) {
+    FILE* file = fmemopen((void*)data.data(), data.size(), "rb");
+    if (!file) throw runtime_error("Cannot read request image");
+    try {
+        img.load_bmp(file);
+    } catch (const CImgException&) {
+        fclose(file);
+        throw runtime_error("Request image is not a valid BMP");
+    }
+    fclose(file);
+}
+
+// Planar image -> the file CImg's save_bmp would write
+static void encode_bmp(const CImg<unsigned char>& img, string& out) {
+    int w = img.width(), h = img.height();
+    size_t stride = (3 * (size_t)w + 3) & ~(size_t)3;
+    out.assign(54 + stride * h, '\0');
+    unsigned char* file = (unsigned char*)&out[0];
+    bmp24_header(file, w, h);
+    parallel_for_rows(1, h, [&](int, int y0, int y1) {
+        for (int y = y0; y < y1; ++y) bmp24_row(img, y, file + 54 + stride * (h - 1 - y));
+    });
+}
+
+// Run one request; report and progress lines go to text, a returned
+// image to image
+static void handle_request(Request& req, WorkerState& state, ostream& text, string& image) {
+    CommandOptions& opts = req.opts;
+    bool fromData = req.dataBytes > 0;
+    if (!fromData && opts.inputPath.empty()) throw runtime_error("No input file specified");
+    string input = fromData ? "<data>" : opts.inputPath;
+    if (opts.command == "--histogram" && opts.outputPath.empty()) {
+        throw runtime_error("--histogram needs an output path");
+    }
+    string outputPath = opts.outputPath.empty() && !req.returnImage ? "output.bmp"
+                                                                    : opts.outputPath;
+    ostringstream report, log;
+
+    // Same dispatch as a single run: mapped files and payloads go to the
+    // interleaved or histogram-only paths when the command has one
+    bool mapped = fromData ? state.bmp.open_memory(state.data.data(), state.data.size(), input)
+                           : state.bmp.open(opts.inputPath);
+    if (mapped && !req.returnImage && interleaved_supports(opts, state.bmp)) {
+        run_interleaved(opts, state.bmp, outputPath, text);
+        text << "Saved: " << outputPath << "\n";
+        return;
+    }
+    if (mapped && command_uses_histograms_only(opts)) {
+        run_histogram_command(opts, state.bmp.histograms(), state.bmp.width(),
+                              state.bmp.height(), input, opts.outputPath, report, log);
+        text << report.str() << log.str();
+        return;
+    }
+    if (mapped) state.bmp.to_planar(state.img);
+    else if (fromData) decode_bmp(state.data, state.img);
+    else state.img.load(opts.inputPath.c_str());
+
+    run_command(opts, state.img, input, opts.outputPath, state.result, report, log);
+    text << report.str() << log.str();
+    if (!command_writes_image(opts.command)) return;
+    if (req.returnImage) {
+        encode_bmp(state.result, image);
+    } else {
+        state.result.save(outputPath.c_str());
+        text << "Saved: " << outputPath << "\n";
+    }
+}
+
+static void send_response(Connection& conn, bool ok, const string& text, const string& image) {
+    string status = string(ok ? "OK " : "ERR ") + to_string(text.size()) + " " +
+                    to_string(image.size()) + "\n";
+    // One buffer, so small answers leave in a single write
+    string response;
+    response.reserve(status.size() + text.size() + image.size());
+    response += status;
+    response += text;
+    response += image;
+    conn.write_all(response.data(), response.size());
+}
+
+static void serve_connection(int fd, WorkerState& state) {
+    Connection conn(fd);
+    string line, image;
+    for (;;) {
+        try {
+            if (!conn.read_line(line)) return;
+        } catch (const exception& e) {
+            // The rest of an oversized line cannot be told from the next
+            // request: answer, then drop this client only
+            send_response(conn, false, string(e.what()) + "\n", "");
+            conn.finish(MAX_REQUEST_DISCARD);
+            return;
+        }
+        vector<string> args = split_arguments(line);
+        if (args.empty()) continue;
+        if (args.size() == 1 && args[0] == "--shutdown") {
+            stopping = true;
+            shutdown(listen_fd, SHUT_RDWR);  // Wakes the workers blocked in accept()
+            send_response(conn, true, "", "");
+            return;
+        }
+
+        ostringstream text;
+        image.clear();
+        bool parsed = false;
+        try {
+            Request req = parse_request(args);
+            parsed = true;
+            if (req.dataBytes > 0) {
+                state.data.resize(req.dataBytes);
+                if (!conn.read_exact(state.data.data(), req.dataBytes)) return;
+            }
+            handle_request(req, state, text, image);
+        } catch (const exception& e) {
+            send_response(conn, false, string(e.what()) + "\n", "");
+            // The payload of a request that did not parse cannot be
+            // skipped, so the stream is lost
+            if (!parsed && line.find("-data=") != string::npos) return;
+            continue;
+        }
+        send_response(conn, true, text.str(), image);
+    }
+}
+
+static void worker_loop() {
+    WorkerState state;
+    while (!stopping) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;
+        }
+        // Nothing a client sends may take the server down
+        try {
+            serve_connection(fd, state);
+        } catch (const exception& e) {
+            cerr << "Connection closed: " << e.what() << "\n";
+        }
+    }
+}
+
+int run_serve(const CommandOptions& opts) {
+    string path = opts.socketPath.empty() ? "imageProcessor.sock" : opts.socketPath;
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) throw runtime_error("Socket path too long: " + path);
+    memcpy(addr.sun_path, path.c_str(), path.size());
+
+    // Clients that hang up must not kill the server
+    signal(SIGPIPE, SIG_IGN);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) throw runtime_error("Cannot create socket");
+    // A stale socket from a previous run; anything else at path is kept
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            close(listen_fd);
+            throw runtime_error(path + " exists and is not a socket");
+        }
+        unlink(path.c_str());
+    }
+    if (bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd, 64) != 0) {
+        close(listen_fd);
+        throw runtime_error("Cannot listen on " + path);
+    }
+
+    // Requests of different clients run side by side; each one's filters
+    // use the thread pool when it is free and run inline otherwise
+    int workers = thread_count();
+    cout << "Serving on " << path << " (" << workers << " workers)\n" << flush;
+    vector<thread> threads;
+    for (int i = 1; i < workers; ++i) threads.emplace_back(worker_loop);
+    worker_loop();
+    for (auto& t : threads) t.join();
+
+    close(listen_fd);
+    unlink(path.c_str());
+    cout << "Server stopped\n";
+    return 0;
+}
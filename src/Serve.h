@@ -0,0 +1,33 @@
+#ifndef SERVE_H
+#define SERVE_H
+
+#include "Commands.h"
+
+// --serve: a long-running process answering requests on a Unix domain
+// socket (-socket=PATH), so callers skip process start-up per image.
+//
+// A request is one line of command line arguments, separated by spaces:
+//
+//   --sedgesharp -variant=2 -input=in.bmp -output=out.bmp\n
+//
+// Any command and option of a normal run is accepted except -batch,
+// -stream and -threads. Two additions carry images over the socket:
+//
+//   -data=N      N bytes of a BMP file follow the line (instead of -input)
+//   -output=-    the result BMP is returned in the response
+//
+// The answer is a status line followed by the text the command printed
+// (reports, then progress lines) and the image bytes:
+//
+//   OK <textBytes> <imageBytes>\n<text><image>
+//   ERR <textBytes> 0\n<message>
+//
+// "--shutdown" stops the server. A connection may send any number of
+// requests without waiting; they are answered in order. The server
+// accepts with -threads workers, each serving one connection at a time
+// with image buffers that stay allocated between requests.
+//
+// Returns the process exit code; throws if the socket cannot be opened.
+int run_serve(const CommandOptions& opts);
+
+#endif
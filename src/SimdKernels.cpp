@@ -0,0 +1,350 @@
+#include "SimdKernels.h"
+#include <algorithm>
+#include <cstdint>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#else
+#define SIMD_X86 0
+#endif
+
+using namespace std;
+
+// ---------------------------------------------------------------------------
+// CPU dispatch
+// ---------------------------------------------------------------------------
+
+SimdLevel simd_detect() {
+#if SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512vbmi")) return SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+    if (__builtin_cpu_supports("sse2")) return SIMD_SSE2;
+#endif
+    return SIMD_SCALAR;
+}
+
+static SimdLevel& current_level() {
+    static SimdLevel level = simd_detect();
+    return level;
+}
+
+SimdLevel simd_level() {
+    return current_level();
+}
+
+void simd_set_level(SimdLevel level) {
+    current_level() = min(level, simd_detect());
+}
+
+const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+        case SIMD_AVX512: return "avx512";
+        case SIMD_AVX2: return "avx2";
+        case SIMD_SSE2: return "sse2";
+        default:        return "scalar";
+    }
+}
+
+// ---------------------------------------------------------------------------
+// 3x3 integer convolution
+// ---------------------------------------------------------------------------
+
+static void conv3x3_row_scalar(const unsigned char* const rows[3],
+                               unsigned char* dst, int x, int n,
+                               const short k[9], int step) {
+    for (; x < n; ++x) {
+        int sum = 0;
+        for (int i = 0; i < 3; ++i) {
+            const unsigned char* r = rows[i] + x;
+            sum += k[3*i] * r[-step] + k[3*i + 1] * r[0] + k[3*i + 2] * r[step];
+        }
+        dst[x] = (unsigned char)max(0, min(sum, 255));
+    }
+}
+
+#if SIMD_X86
+
+__attribute__((target("sse2")))
+static int conv3x3_row_sse2(const unsigned char* const rows[3],
+                            unsigned char* dst, int x, int n,
+                            const short k[9], int step) {
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 16 <= n; x += 16) {
+        __m128i lo = zero, hi = zero;
+        for (int t = 0; t < 9; ++t) {
+            if (k[t] == 0) continue;
+            const unsigned char* p = rows[t / 3] + x + (t % 3 - 1) * step;
+            __m128i v = _mm_loadu_si128((const __m128i*)p);
+            __m128i kv = _mm_set1_epi16(k[t]);
+            lo = _mm_add_epi16(lo, _mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), kv));
+            hi = _mm_add_epi16(hi, _mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), kv));
+        }
+        // packus saturates to [0, 255], which is exactly the clamp
+        _mm_storeu_si128((__m128i*)(dst + x), _mm_packus_epi16(lo, hi));
+    }
+    return x;
+}
+
+__attribute__((target("avx2")))
+static int conv3x3_row_avx2(const unsigned char* const rows[3],
+                            unsigned char* dst, int x, int n,
+                            const short k[9], int step) {
+    for (; x + 32 <= n; x += 32) {
+        __m256i lo = _mm256_setzero_si256(), hi = _mm256_setzero_si256();
+        for (int t = 0; t < 9; ++t) {
+            if (k[t] == 0) continue;
+            const unsigned char* p = rows[t / 3] + x + (t % 3 - 1) * step;
+            __m256i kv = _mm256_set1_epi16(k[t]);
+            __m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)p));
+            __m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(p + 16)));
+            lo = _mm256_add_epi16(lo, _mm256_mullo_epi16(a, kv));
+            hi = _mm256_add_epi16(hi, _mm256_mullo_epi16(b, kv));
+        }
+        // packus works per 128-bit lane; restore linear order afterwards
+        __m256i packed = _mm256_packus_epi16(lo, hi);
+        packed = _mm256_permute4x64_epi64(packed, 0xD8);
+        _mm256_storeu_si256((__m256i*)(dst + x), packed);
+    }
+    return x;
+}
+
+#endif
+
+void conv3x3_row_u8(const unsigned char* r0, const unsigned char* r1,
+                    const unsigned char* r2, unsigned char* dst, int n,
+                    const short k[9], int step) {
+    const unsigned char* rows[3] = { r0, r1, r2 };
+    int x = 0;
+#if SIMD_X86
+    SimdLevel level = simd_level();
+    if (level >= SIMD_AVX2) x = conv3x3_row_avx2(rows, dst, x, n, k, step);
+    if (level >= SIMD_SSE2) x = conv3x3_row_sse2(rows, dst, x, n, k, step);
+#endif
+    conv3x3_row_scalar(rows, dst, x, n, k, step);
+}
+
+// ---------------------------------------------------------------------------
+// m x m fixed-point convolution
+// ---------------------------------------------------------------------------
+
+// Without negative taps the 16-bit sums are unsigned, which doubles their
+// range: shift them logically
+static bool has_negative(const short* k, int m) {
+    for (int t = 0; t < m * m; ++t) {
+        if (k[t] < 0) return true;
+    }
+    return false;
+}
+
+static void convmxm_row_scalar(const unsigned char* const* rows, unsigned char* dst,
+                               int x, int n, const short* k, int m, int shift) {
+    int half = (1 << shift) >> 1;
+    for (; x < n; ++x) {
+        int sum = 0;
+        for (int i = 0; i < m; ++i) {
+            for (int j = 0; j < m; ++j) sum += k[m*i + j] * rows[i][x + j];
+        }
+        dst[x] = (unsigned char)max(0, min((sum + half) >> shift, 255));
+    }
+}
+
+#if SIMD_X86
+
+__attribute__((target("sse2")))
+static int convmxm_row_sse2(const unsigned char* const* rows, unsigned char* dst,
+                            int x, int n, const short* k, int m, int shift) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i half = _mm_set1_epi16((short)((1 << shift) >> 1));
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    bool logical = !has_negative(k, m);
+    for (; x + 16 <= n; x += 16) {
+        __m128i lo = half, hi = half;
+        for (int t = 0; t < m * m; ++t) {
+            if (k[t] == 0) continue;
+            __m128i v = _mm_loadu_si128((const __m128i*)(rows[t / m] + x + t % m));
+            __m128i kv = _mm_set1_epi16(k[t]);
+            lo = _mm_add_epi16(lo, _mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), kv));
+            hi = _mm_add_epi16(hi, _mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), kv));
+        }
+        lo = logical ? _mm_srl_epi16(lo, count) : _mm_sra_epi16(lo, count);
+        hi = logical ? _mm_srl_epi16(hi, count) : _mm_sra_epi16(hi, count);
+        _mm_storeu_si128((__m128i*)(dst + x), _mm_packus_epi16(lo, hi));
+    }
+    return x;
+}
+
+__attribute__((target("avx2")))
+static int convmxm_row_avx2(const unsigned char* const* rows, unsigned char* dst,
+                            int x, int n, const short* k, int m, int shift) {
+    const __m256i half = _mm256_set1_epi16((short)((1 << shift) >> 1));
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    bool logical = !has_negative(k, m);
+    for (; x + 32 <= n; x += 32) {
+        __m256i lo = half, hi = half;
+        for (int t = 0; t < m * m; ++t) {
+            if (k[t] == 0) continue;
+            const unsigned char* p = rows[t / m] + x + t % m;
+            __m256i kv = _mm256_set1_epi16(k[t]);
+            __m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)p));
+            __m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(p + 16)));
+            lo = _mm256_add_epi16(lo, _mm256_mullo_epi16(a, kv));
+            hi = _mm256_add_epi16(hi, _mm256_mullo_epi16(b, kv));
+        }
+        lo = logical ? _mm256_srl_epi16(lo, count) : _mm256_sra_epi16(lo, count);
+        hi = logical ? _mm256_srl_epi16(hi, count) : _mm256_sra_epi16(hi, count);
+        __m256i packed = _mm256_packus_epi16(lo, hi);
+        packed = _mm256_permute4x64_epi64(packed, 0xD8);
+        _mm256_storeu_si256((__m256i*)(dst + x), packed);
+    }
+    return x;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static int convmxm_row_avx512(const unsigned char* const* rows, unsigned char* dst,
+                              int x, int n, const short* k, int m, int shift) {
+    const __m512i half = _mm512_set1_epi16((short)((1 << shift) >> 1));
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    // packus interleaves 128-bit lanes of lo and hi; this puts them back
+    const __m512i order = _mm512_set_epi64(7, 5, 3, 1, 6, 4, 2, 0);
+    bool logical = !has_negative(k, m);
+    for (; x + 64 <= n; x += 64) {
+        __m512i lo = half, hi = half;
+        for (int t = 0; t < m * m; ++t) {
+            if (k[t] == 0) continue;
+            const unsigned char* p = rows[t / m] + x + t % m;
+            __m512i kv = _mm512_set1_epi16(k[t]);
+            __m512i a = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i*)p));
+            __m512i b = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i*)(p + 32)));
+            lo = _mm512_add_epi16(lo, _mm512_mullo_epi16(a, kv));
+            hi = _mm512_add_epi16(hi, _mm512_mullo_epi16(b, kv));
+        }
+        lo = logical ? _mm512_srl_epi16(lo, count) : _mm512_sra_epi16(lo, count);
+        hi = logical ? _mm512_srl_epi16(hi, count) : _mm512_sra_epi16(hi, count);
+        // (maskz form: the plain intrinsic trips -Wmaybe-uninitialized in GCC)
+        __m512i packed = _mm512_maskz_permutexvar_epi64(0xFF, order, _mm512_packus_epi16(lo, hi));
+        _mm512_storeu_si512((void*)(dst + x), packed);
+    }
+    return x;
+}
+
+#endif
+
+void convmxm_row_u8(const unsigned char* const* rows, unsigned char* dst, int n,
+                    const short* k, int m, int shift) {
+    int x = 0;
+#if SIMD_X86
+    SimdLevel level = simd_level();
+    if (level >= SIMD_AVX512) x = convmxm_row_avx512(rows, dst, x, n, k, m, shift);
+    if (level >= SIMD_AVX2) x = convmxm_row_avx2(rows, dst, x, n, k, m, shift);
+    if (level >= SIMD_SSE2) x = convmxm_row_sse2(rows, dst, x, n, k, m, shift);
+#endif
+    convmxm_row_scalar(rows, dst, x, n, k, m, shift);
+}
+
+// ---------------------------------------------------------------------------
+// 256-entry lookup table
+// ---------------------------------------------------------------------------
+
+static void apply_lut_scalar(const unsigned char* src, unsigned char* dst,
+                             size_t i, size_t n, const unsigned char lut[256]) {
+    for (; i + 4 <= n; i += 4) {
+        unsigned char a = lut[src[i]], b = lut[src[i + 1]];
+        unsigned char c = lut[src[i + 2]], d = lut[src[i + 3]];
+        dst[i] = a; dst[i + 1] = b; dst[i + 2] = c; dst[i + 3] = d;
+    }
+    for (; i < n; ++i) dst[i] = lut[src[i]];
+}
+
+#if SIMD_X86
+
+// vpermi2b indexes 128 bytes with the low 7 bits, so two permutes cover
+// the whole table and bit 7 picks between them: 64 pixels in ~4 ops.
+// (AVX2 vpshufb/gather variants measured slower than the scalar loop.)
+__attribute__((target("avx512f,avx512bw,avx512vbmi")))
+static size_t apply_lut_avx512(const unsigned char* src, unsigned char* dst,
+                               size_t n, const unsigned char lut[256]) {
+    const __m512i t0 = _mm512_loadu_si512((const void*)lut);
+    const __m512i t1 = _mm512_loadu_si512((const void*)(lut + 64));
+    const __m512i t2 = _mm512_loadu_si512((const void*)(lut + 128));
+    const __m512i t3 = _mm512_loadu_si512((const void*)(lut + 192));
+
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m512i v = _mm512_loadu_si512((const void*)(src + i));
+        __m512i lo = _mm512_permutex2var_epi8(t0, v, t1);
+        __m512i hi = _mm512_permutex2var_epi8(t2, v, t3);
+        __m512i r = _mm512_mask_blend_epi8(_mm512_movepi8_mask(v), lo, hi);
+        _mm512_storeu_si512((void*)(dst + i), r);
+    }
+    return i;
+}
+
+// Interleaved three-table variant: byte i uses luts[i % 3]. 64 = 1 mod 3,
+// so three consecutive vectors start at channel phases 0, 1 and 2 and
+// each byte's table follows from a fixed mask per (vector, channel).
+__attribute__((target("avx512f,avx512bw,avx512vbmi")))
+static size_t apply_lut3_avx512(const unsigned char* src, unsigned char* dst,
+                                size_t n, const unsigned char* const luts[3]) {
+    __m512i t[3][4];
+    for (int c = 0; c < 3; ++c) {
+        for (int q = 0; q < 4; ++q) {
+            t[c][q] = _mm512_loadu_si512((const void*)(luts[c] + 64 * q));
+        }
+    }
+    // mask[v][c]: bytes of vector v (offset 64 * v) that belong to channel c
+    __mmask64 mask[3][3];
+    for (int v = 0; v < 3; ++v) {
+        for (int c = 0; c < 3; ++c) {
+            uint64_t m = 0;
+            for (int b = 0; b < 64; ++b) {
+                if ((64 * v + b) % 3 == c) m |= (uint64_t)1 << b;
+            }
+            mask[v][c] = m;
+        }
+    }
+
+    size_t i = 0;
+    for (; i + 192 <= n; i += 192) {
+        for (int v = 0; v < 3; ++v) {
+            __m512i x = _mm512_loadu_si512((const void*)(src + i + 64 * v));
+            __mmask64 high = _mm512_movepi8_mask(x);
+            __m512i r = _mm512_setzero_si512();
+            for (int c = 0; c < 3; ++c) {
+                __m512i lo = _mm512_permutex2var_epi8(t[c][0], x, t[c][1]);
+                __m512i hi = _mm512_permutex2var_epi8(t[c][2], x, t[c][3]);
+                __m512i y = _mm512_mask_blend_epi8(high, lo, hi);
+                r = _mm512_mask_mov_epi8(r, mask[v][c], y);
+            }
+            _mm512_storeu_si512((void*)(dst + i + 64 * v), r);
+        }
+    }
+    return i;
+}
+
+#endif
+
+void apply_lut3_u8(const unsigned char* src, unsigned char* dst, size_t n,
+                   const unsigned char* const luts[3]) {
+    size_t i = 0;
+#if SIMD_X86
+    if (simd_level() >= SIMD_AVX512) i = apply_lut3_avx512(src, dst, n, luts);
+#endif
+    for (; i + 3 <= n; i += 3) {
+        dst[i] = luts[0][src[i]];
+        dst[i + 1] = luts[1][src[i + 1]];
+        dst[i + 2] = luts[2][src[i + 2]];
+    }
+    for (int c = 0; i < n; ++i, ++c) dst[i] = luts[c][src[i]];
+}
+
+void apply_lut_u8(const unsigned char* src, unsigned char* dst, size_t n,
+                  const unsigned char lut[256]) {
+    size_t i = 0;
+#if SIMD_X86
+    if (simd_level() >= SIMD_AVX512) i = apply_lut_avx512(src, dst, n, lut);
+#endif
+    apply_lut_scalar(src, dst, i, n, lut);
+}
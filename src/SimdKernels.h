@@ -0,0 +1,60 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+#include <cstddef>
+
+// Row kernels on raw 8-bit buffers with runtime CPU dispatch.
+// No CImg here: callers hand in row pointers into planar channel buffers,
+// or into interleaved BGR rows with a pixel step of 3.
+
+// Instruction sets the dispatcher can pick from
+enum SimdLevel {
+    SIMD_SCALAR = 0,
+    SIMD_SSE2   = 1,
+    SIMD_AVX2   = 2,
+    SIMD_AVX512 = 3   // AVX-512 BW + VBMI
+};
+
+// Highest level supported by this CPU
+SimdLevel simd_detect();
+
+// Level currently used by the kernels (defaults to simd_detect())
+SimdLevel simd_level();
+
+// Cap the level (e.g. to compare paths); clamped to what the CPU supports
+void simd_set_level(SimdLevel level);
+
+const char* simd_level_name(SimdLevel level);
+
+// 3x3 integer mask over one output row:
+//   dst[x] = clamp(sum k[3*i + j] * ri[x + (j - 1) * step], 0, 255),  0 <= x < n
+// r0/r1/r2 point at the first output byte of the rows above, at and
+// below, so ri[-step] and ri[n - 1 + step] must be readable. step is the
+// distance between horizontal neighbours: 1 for planar rows, 3 for
+// interleaved BGR, where the lanes then cover all three channels at once.
+// Accumulates in int16: requires 255 * sum|k| <= 32767.
+void conv3x3_row_u8(const unsigned char* r0, const unsigned char* r1,
+                    const unsigned char* r2, unsigned char* dst, int n,
+                    const short k[9], int step = 1);
+
+// Odd m x m integer mask with shift fraction bits over one output row:
+//   dst[x] = clamp((sum k[m*i + j] * rows[i][x + j] + half) >> shift, 0, 255)
+// with half = 2^shift / 2, i.e. the exact sum / 2^shift rounded half up
+// (negative sums clamp to 0 either way). rows[i] points m/2 bytes left of
+// the first output byte in row i, so rows[i][0 .. n + m - 2] must be
+// readable. Accumulates in 16 bits: requires 255 * sum|k| + half <= 32767,
+// or for masks without negative taps and shift >= 1, <= 65535 (unsigned).
+void convmxm_row_u8(const unsigned char* const* rows, unsigned char* dst, int n,
+                    const short* k, int m, int shift);
+
+// Point op through a 256-entry table: dst[i] = lut[src[i]], 0 <= i < n.
+// src == dst is allowed. Uses AVX-512 VBMI byte permutes when available.
+void apply_lut_u8(const unsigned char* src, unsigned char* dst, size_t n,
+                  const unsigned char lut[256]);
+
+// Interleaved variant: dst[i] = luts[i % 3][src[i]], e.g. one table per
+// channel of a BGR row. src == dst is allowed.
+void apply_lut3_u8(const unsigned char* src, unsigned char* dst, size_t n,
+                   const unsigned char* const luts[3]);
+
+#endif
@@ -0,0 +1,182 @@
+#include "Stream.h"
+#include "BmpStream.h"
+#include "Parallel.h"
+#include "Pipeline.h"
+#include "Profile.h"
+#include "SimdKernels.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+// Default pixel bytes per strip (all three channels)
+static const size_t STREAM_STRIP_BYTES = 32 * 1024 * 1024;
+
+// read_rows / write_rows, timed as the decode and encode stages
+static void read_strip(BmpReader& reader, int y, int count, CImg<unsigned char>& dst,
+                       int dstRow) {
+    ProfileScope scope("decode");
+    reader.read_rows(y, count, dst, dstRow);
+    uint64_t pixels = (uint64_t)count * reader.width();
+    scope.counts(reader.stride() * count, 3 * pixels, pixels);
+}
+
+static void write_strip(BmpWriter& writer, const CImg<unsigned char>& src, int srcRow,
+                        int count, int y) {
+    ProfileScope scope("encode");
+    writer.write_rows(src, srcRow, count, y);
+    uint64_t pixels = (uint64_t)count * src.width();
+    scope.counts(src.spectrum() * pixels, ((3 * (uint64_t)src.width() + 3) & ~3ull) * count,
+                 pixels);
+}
+
+// Per-channel histograms of the whole file, one strip at a time
+static vector<vector<uint64_t>> stream_histograms(BmpReader& reader, int stripRows) {
+    int w = reader.width(), h = reader.height();
+    vector<vector<uint64_t>> total(3, vector<uint64_t>(256, 0));
+    CImg<unsigned char> strip;
+    for (int y0 = 0; y0 < h; y0 += stripRows) {
+        int rows = min(stripRows, h - y0);
+        strip.assign(w, rows, 1, 3);
+        read_strip(reader, y0, rows, strip, 0);
+        ProfileScope scope("histograms");
+        auto hists = compute_histograms(strip);
+        scope.counts(strip.size(), 0, (uint64_t)w * rows);
+        for (int c = 0; c < 3; ++c) {
+            for (int v = 0; v < 256; ++v) total[c][v] += hists[c][v];
+        }
+    }
+    return total;
+}
+
+// H4 in two passes: histograms, then every strip through the channel LUTs
+static void stream_hpower(const CommandOptions& opts, BmpReader& reader,
+                          BmpWriter& writer, int stripRows) {
+    int w = reader.width(), h = reader.height();
+    auto luts = power23_luts(stream_histograms(reader, stripRows), opts.gmin, opts.gmax);
+
+    CImg<unsigned char> strip;
+    for (int y0 = 0; y0 < h; y0 += stripRows) {
+        int rows = min(stripRows, h - y0);
+        strip.assign(w, rows, 1, 3);
+        read_strip(reader, y0, rows, strip, 0);
+        {
+            ProfileScope scope("hpower");
+            parallel_for_rows(3, rows, [&](int c, int r0, int r1) {
+                unsigned char* p = strip.data(0, r0, 0, c);
+                apply_lut_u8(p, p, (size_t)(r1 - r0) * w, luts[c].data());
+            });
+            scope.counts(strip.size(), strip.size(), (uint64_t)w * rows);
+        }
+        write_strip(writer, strip, 0, rows, y0);
+    }
+}
+
+// Neighbourhood filters over a sliding window of rows: each output strip
+// [y0, y1) is computed from image rows [y0 - halo, y1 + halo), clipped to
+// the image. Rows the previous window already holds are copied over
+// instead of read again. Where the window is clipped its edge is the
+// image edge, so border modes behave as on the whole image; elsewhere
+// the halo absorbs the window edge.
+static void stream_filters(const CommandOptions& opts, int haloY, BmpReader& reader,
+                           BmpWriter& writer, int stripRows) {
+    int w = reader.width(), h = reader.height();
+    CImg<unsigned char> window, next, out;
+    int winY0 = 0, winY1 = 0;  // Image rows held by window
+    ostream discard(nullptr);  // Filter messages would repeat per strip
+    ostringstream noReport;
+
+    for (int y0 = 0; y0 < h; y0 += stripRows) {
+        int y1 = min(h, y0 + stripRows);
+        int a = max(0, y0 - haloY), b = min(h, y1 + haloY);
+
+        next.assign(w, b - a, 1, 3);
+        int keep = max(a, min(b, winY1));  // Rows [a, keep) come from window
+        for (int c = 0; c < 3 && keep > a; ++c) {
+            memcpy(next.data(0, 0, 0, c), window.data(0, a - winY0, 0, c),
+                   (size_t)(keep - a) * w);
+        }
+        read_strip(reader, keep, b - keep, next, keep - a);
+        window.swap(next);
+        winY0 = a;
+        winY1 = b;
+
+        {
+            ProfileScope scope(command_stage_name(opts.command));
+            run_command(opts, window, "", "", out, noReport, discard);
+            scope.counts(window.size(), out.size(), (uint64_t)w * (b - a));
+        }
+        write_strip(writer, out, y0 - a, y1 - y0, y0);
+    }
+}
+
+int run_stream(const CommandOptions& opts) {
+    const string& command = opts.command;
+    if (command == "--characteristics" && !command_uses_histograms_only(opts)) {
+        throw runtime_error("-tile and -region are not supported with -stream");
+    }
+
+    // Image commands: every stage needs a bounded, local neighbourhood
+    int haloY = 0;
+    bool filters = command_writes_image(command) && command != "--hpower";
+    if (filters) {
+        vector<CommandOptions> stages;
+        if (command.find("--pipeline=") == 0) {
+            stages = parse_pipeline(command.substr(11), opts);
+        } else {
+            stages.push_back(opts);
+        }
+        for (const CommandOptions& stage : stages) {
+            int rx, ry;
+            if (!stage_radius(stage, rx, ry)) {
+                bool wrap = stage.borderSet && stage.border.mode == BORDER_WRAP;
+                throw runtime_error("-stream cannot run " + stage.command +
+                                    (wrap ? " with -border=wrap" : " inside a pipeline"));
+            }
+            haloY += ry;
+        }
+    }
+    else if (command != "--hpower" && command != "--histogram" &&
+             command != "--characteristics") {
+        throw runtime_error(command + " cannot be streamed");
+    }
+
+    // Writing the file being read would overwrite rows not yet consumed
+    string outputPath = opts.outputPath.empty() ? "output.bmp" : opts.outputPath;
+    if (command != "--characteristics" && outputPath == opts.inputPath) {
+        throw runtime_error("-stream cannot write over its input");
+    }
+
+    BmpReader reader(opts.inputPath);
+    int w = reader.width(), h = reader.height();
+    int stripRows = opts.stripRows > 0
+                        ? opts.stripRows
+                        : (int)max<size_t>(16, STREAM_STRIP_BYTES / (3 * (size_t)w));
+    stripRows = min(stripRows, h);
+
+    bool machineOutput = command == "--characteristics" &&
+                         opts.format != FORMAT_TEXT && opts.outputPath.empty();
+    ostream& log = machineOutput ? cerr : cout;
+    log << "Streaming: " << opts.inputPath << " (" << w << "x" << h << ") in strips of "
+        << stripRows << " rows\n";
+
+    if (command == "--histogram" || command == "--characteristics") {
+        run_histogram_command(opts, stream_histograms(reader, stripRows), w, h, opts.inputPath,
+                              command == "--histogram" ? outputPath : opts.outputPath,
+                              cout, log);
+        return 0;
+    }
+
+    BmpWriter writer(outputPath, w, h);
+    if (filters) {
+        stream_filters(opts, haloY, reader, writer, stripRows);
+    } else {
+        stream_hpower(opts, reader, writer, stripRows);
+    }
+    writer.close();
+    cout << "Saved: " << outputPath << "\n";
+    return 0;
+}
@@ -0,0 +1,21 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "Commands.h"
+
+// -stream: run opts.command on a BMP without decoding it whole. Rows are
+// read in strips of opts.stripRows (default: about STREAM_STRIP_BYTES of
+// pixels) and results are written strip by strip, so memory stays bounded
+// by a few strips whatever the image size.
+//
+//   --sedgesharp, --orosenfeld and pipelines of them: a sliding window of
+//     strip + 2 * halo rows; output is identical to whole-image runs
+//     (wrap borders excepted, which need the opposite edge)
+//   --hpower: one pass for the histograms, one to remap
+//   --histogram, --characteristics: one pass (whole image only)
+//
+// Returns the process exit code; throws on unsupported commands and
+// I/O errors.
+int run_stream(const CommandOptions& opts);
+
+#endif
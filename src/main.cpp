@@ -1,15 +1,29 @@
-#include "Histogram.h"
-#include "LinearFilters.h"
-#include "NonLinearFilters.h"
-#include <iomanip> 
+#include "Batch.h"
+#include "Bench.h"
+#include "Commands.h"
+#include "Interleaved.h"
+#include "MappedBmp.h"
+#include "Profile.h"
+#include "Serve.h"
+#include "Stream.h"
+#include <fstream>
 #include <iostream>
+#include <sys/stat.h>
 #include <string>
 
 using namespace std;
 
+static uint64_t file_size(const string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? (uint64_t)st.st_size : 0;
+}
+
 void printHelp() {
     cout << "Image Processing - Task 2\n";
-    cout << "Usage: ./imageProcessor --command -input=file -output=file [options]\n\n";
+    cout << "Usage: ./imageProcessor --command -input=file -output=file [options]\n";
+    cout << "       ./imageProcessor --command -batch=DIR|LIST [-output=TEMPLATE] [options]\n";
+    cout << "       ./imageProcessor --serve [-socket=PATH] [-threads=N]\n";
+    cout << "       ./imageProcessor --bench [-input=DIR] [-output=JSON] [-baseline=JSON]\n\n";
     cout << "Commands:\n";
     cout << "  --hpower         : Apply H4 power 2/3 histogram equalization\n";
     cout << "  --histogram      : Save histogram as image\n";
@@ -18,123 +32,150 @@ void printHelp() {
     cout << "                     Options: -variant=1,2,3 or -optimized\n";
     cout << "  --orosenfeld     : Apply Rosenfeld operator (O5)\n";
     cout << "                     Options: -P=1,2,4,8,16\n";
+    cout << "                              -direction=horizontal,vertical,both\n";
+    cout << "  --amean          : Arithmetic mean filter\n";
+    cout << "                     Options: -kernel=N (odd, default: 3)\n";
+    cout << "  --gaussian       : Gaussian blur from three stacked box filters\n";
+    cout << "                     Options: -sigma=S (default: 1)\n";
+    cout << "  --median         : Median filter\n";
+    cout << "                     Options: -kernel=N (odd, default: 3)\n";
+    cout << "  --amedian        : Adaptive median filter (impulse noise)\n";
+    cout << "                     Options: -kernel=N (odd, default: 3)\n";
+    cout << "                              -smax=N (odd, >= N, default: 7)\n";
+    cout << "                     --amean, --gaussian and --median cost the same per\n";
+    cout << "                     pixel at any size\n";
+    cout << "  --pipeline=SPEC  : Run several commands in memory, e.g.\n";
+    cout << "                     --pipeline=sedgesharp:variant=2,hpower:gmin=10,characteristics\n";
+    cout << "                     Stages are separated by ',', their options by ':'\n";
+    cout << "                     Consecutive filter stages (all of the above but\n";
+    cout << "                     --hpower) run tile by tile in cache (-nofuse\n";
+    cout << "                     disables this)\n";
+    cout << "  --serve          : Answer requests on a Unix socket until --shutdown\n";
+    cout << "                     Each request is one line of arguments, e.g.\n";
+    cout << "                     --hpower -input=a.bmp -output=b.bmp; -data=N sends\n";
+    cout << "                     N bytes of BMP after the line, -output=- returns the\n";
+    cout << "                     result (see src/Serve.h for the protocol)\n";
+    cout << "  --bench          : Time every filter over the BMPs in -input=DIR (default:\n";
+    cout << "                     images/) and synthetic 1024^2/4096^2 images; -output=\n";
+    cout << "                     saves JSON, -baseline= compares with an earlier one\n";
     cout << "\nOptions:\n";
     cout << "  -input=PATH      : Input image file\n";
     cout << "  -output=PATH     : Output image file\n";
+    cout << "  -batch=DIR|LIST  : Process every .bmp in DIR, or each path listed in LIST\n";
+    cout << "                     -output= is then a template: {name} = input file name\n";
+    cout << "                     without extension, {index} = position (default:\n";
+    cout << "                     {name}_out.bmp); images run in parallel\n";
     cout << "  -channel=N       : Channel for histogram (0,1,2)\n";
+    cout << "                     --characteristics also accepts -channel=all\n";
+    cout << "  -format=FMT      : --characteristics output: text, csv or json\n";
+    cout << "  -tile=WxH        : --characteristics per WxH tile\n";
+    cout << "  -region=X,Y,W,H  : --characteristics over a sub-rectangle\n";
     cout << "  -gmin=N          : Min value for histogram (default: 0)\n";
     cout << "  -gmax=N          : Max value for histogram (default: 255)\n";
+    cout << "  -threads=N       : Worker threads (default: all cores)\n";
+    cout << "  -border=MODE     : Border handling for the filters (all image commands but\n";
+    cout << "                     --hpower): clamp, mirror, wrap, constant or copy\n";
+    cout << "                     (default: copy for masks, clamp otherwise)\n";
+    cout << "  -bordervalue=N   : Outside value for -border=constant, 0-255 (default: 0)\n";
+    cout << "  -planar          : Decode 24-bit BMPs to planes even where a command can\n";
+    cout << "                     run on the interleaved pixels (for comparison)\n";
+    cout << "  -stream          : Process a BMP in row strips without loading it whole\n";
+    cout << "                     (--hpower, --histogram, --characteristics, the\n";
+    cout << "                     filters and pipelines of these)\n";
+    cout << "  -striprows=N     : Rows per strip for -stream (default: ~32 MB of pixels)\n";
+    cout << "  -profile[=PATH]  : Print wall/CPU time, bytes and pixels per stage (decode,\n";
+    cout << "                     each op, encode) to stderr; PATH also gets a Chrome\n";
+    cout << "                     trace (chrome://tracing or ui.perfetto.dev)\n";
+    cout << "  -socket=PATH     : Socket for --serve (default: imageProcessor.sock)\n";
+    cout << "  -baseline=PATH   : --bench results to compare against\n";
+    cout << "  -tolerance=PCT   : --bench slowdown that counts as a regression (default: 10)\n";
+    cout << "  -filter=TEXT     : --bench only the ops whose name contains TEXT\n";
 }
 
-int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        printHelp();
-        return 0;
-    }
-    
-    string command, inputPath, outputPath;
-    int channel = 0, gmin = 0, gmax = 255, variant = 1, P = 1;
-    bool optimized = false;
-    
-    // Parse arguments
-    for (int i = 1; i < argc; ++i) {
-        string arg = argv[i];
-        
-        if (arg == "--help") {
-            printHelp();
-            return 0;
-        }
-        else if (arg.find("--") == 0) {
-            command = arg;
-        }
-        else if (arg.find("-input=") == 0) {
-            inputPath = arg.substr(7);
-        }
-        else if (arg.find("-output=") == 0) {
-            outputPath = arg.substr(8);
-        }
-        else if (arg.find("-channel=") == 0) {
-            channel = stoi(arg.substr(9));
-        }
-        else if (arg.find("-gmin=") == 0) {
-            gmin = stoi(arg.substr(6));
-        }
-        else if (arg.find("-gmax=") == 0) {
-            gmax = stoi(arg.substr(6));
+// Everything after argument parsing; returns the process exit code
+static int run(const CommandOptions& opts) {
+    try {
+        if (opts.command == "--serve") {
+            return run_serve(opts);
         }
-        else if (arg.find("-variant=") == 0) {
-            variant = stoi(arg.substr(9));
+        if (opts.command == "--bench") {
+            return run_bench(opts);
         }
-        else if (arg.find("-P=") == 0) {
-            P = stoi(arg.substr(3));
+        if (!opts.batchPath.empty()) {
+            return run_batch(opts);
         }
-        else if (arg == "-optimized") {
-            optimized = true;
+        if (opts.stream) {
+            if (opts.inputPath.empty()) {
+                cerr << "Error: No input file specified\n";
+                return 1;
+            }
+            return run_stream(opts);
         }
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << "\n";
+        return 1;
     }
     
-    if (inputPath.empty()) {
+    if (opts.inputPath.empty()) {
         cerr << "Error: No input file specified\n";
         return 1;
     }
     
     try {
-        // Load image
-        CImg<unsigned char> img(inputPath.c_str());
-        cout << "Loaded: " << inputPath << " (" << img.width() << "x" 
-             << img.height() << ", " << img.spectrum() << " channels)\n";
+        // Load image: uncompressed 8/24-bit BMPs are mapped and only
+        // decoded when the command needs pixels
+        MappedBmp bmp;
+        CImg<unsigned char> img;
+        bool mapped, histogramsOnly, interleaved;
+        int width, height;
+        {
+            ProfileScope scope("decode");
+            mapped = bmp.open(opts.inputPath);
+            histogramsOnly = mapped && command_uses_histograms_only(opts);
+            interleaved = mapped && interleaved_supports(opts, bmp);
+            if (!mapped) img.load(opts.inputPath.c_str());
+            else if (!histogramsOnly && !interleaved) bmp.to_planar(img);
+            width = mapped ? bmp.width() : img.width();
+            height = mapped ? bmp.height() : img.height();
+            scope.counts(file_size(opts.inputPath), img.size(), (uint64_t)width * height);
+        }
         
-        CImg<unsigned char> result;
+        // Keep stdout clean when it carries CSV/JSON
+        bool machineOutput = opts.command == "--characteristics" &&
+                             opts.format != FORMAT_TEXT && opts.outputPath.empty();
+        (machineOutput ? cerr : cout) << "Loaded: " << opts.inputPath << " (" << width << "x" 
+             << height << ", " << (mapped ? 3 : img.spectrum()) << " channels)\n";
         
         // Process based on command
-        if (command == "--hpower") {
-            result = histogram_power23(img, gmin, gmax);
-            cout << "Applied power 2/3 histogram equalization\n";
-        }
-        else if (command == "--histogram") {
-            auto hist = compute_histogram(img, channel);
-            save_histogram_image(hist, outputPath);
-            return 0;
-        }
-        else if (command == "--characteristics") {
-            auto ch = compute_characteristics(img, channel);
-            cout << fixed << setprecision(4);
-            cout << "\nImage Characteristics (Channel " << channel << "):\n";
-            cout << "  Mean (C1):              " << ch.mean << "\n";
-            cout << "  Variance (C1):          " << ch.variance << "\n";
-            cout << "  Std Deviation (C2):     " << ch.stdev << "\n";
-            cout << "  Var Coefficient I (C2): " << ch.varcoeff_I << "\n";
-            cout << "  Asymmetry (C3):         " << ch.asymmetry << "\n";
-            cout << "  Flattening (C4):        " << ch.flattening << "\n";
-            cout << "  Var Coefficient II (C5):" << ch.varcoeff_II << "\n";
-            cout << "  Entropy (C6):           " << ch.entropy << " bits\n";
+        string outputPath = opts.outputPath.empty() ? "output.bmp" : opts.outputPath;
+        CImg<unsigned char> result;
+        if (interleaved) {
+            run_interleaved(opts, bmp, outputPath, cout);
+            cout << "Saved: " << outputPath << "\n";
             return 0;
         }
-        else if (command == "--sedgesharp") {
-            if (optimized) {
-                result = edge_sharpen_optimized(img);
-                cout << "Applied optimized edge sharpening\n";
+        {
+            ProfileScope scope(command_stage_name(opts.command));
+            if (histogramsOnly) {
+                run_histogram_command(opts, bmp.histograms(), width, height, opts.inputPath,
+                                      opts.outputPath, cout, cout);
+                scope.counts(file_size(opts.inputPath), 0, (uint64_t)width * height);
             } else {
-                if (variant == 1) result = edge_sharpen_type1(img);
-                else if (variant == 2) result = edge_sharpen_type2(img);
-                else if (variant == 3) result = edge_sharpen_type3(img);
-                cout << "Applied edge sharpening (variant " << variant << ")\n";
+                run_command(opts, img, opts.inputPath, opts.outputPath, result, cout, cout);
+                scope.counts(img.size(), result.size(), (uint64_t)width * height);
             }
         }
-        else if (command == "--orosenfeld") {
-            result = rosenfeld_operator(img, P);
-            cout << "Applied Rosenfeld operator (P=" << P << ")\n";
-        }
-        else {
-            cerr << "Unknown command: " << command << "\n";
-            return 1;
+        if (!command_writes_image(opts.command)) {
+            return 0;
         }
         
         // Save result
-        if (outputPath.empty()) {
-            outputPath = "output.bmp";
+        {
+            ProfileScope scope("encode");
+            result.save(outputPath.c_str());
+            scope.counts(result.size(), file_size(outputPath),
+                         (uint64_t)result.width() * result.height());
         }
-        result.save(outputPath.c_str());
         cout << "Saved: " << outputPath << "\n";
         
     } catch (const exception& e) {
@@ -144,3 +185,47 @@ int main(int argc, char* argv[]) {
     
     return 0;
 }
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printHelp();
+        return 0;
+    }
+    
+    CommandOptions opts;
+    
+    // Parse arguments
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        string error;
+        
+        if (arg == "--help") {
+            printHelp();
+            return 0;
+        }
+        else if (arg.find("--") == 0) {
+            opts.command = arg;
+        }
+        else if (!parse_option(arg, opts, error)) {
+            cerr << "Error: " << error << "\n";
+            return 1;
+        }
+    }
+    
+    if (opts.profile) set_profiling(true);
+    int status = run(opts);
+    if (opts.profile) {
+        vector<ProfileRecord> records = profile_records();
+        write_profile_table(cerr, records);
+        if (!opts.profilePath.empty()) {
+            ofstream trace(opts.profilePath.c_str());
+            write_chrome_trace(trace, records);
+            if (!trace) {
+                cerr << "Error: Cannot write " << opts.profilePath << "\n";
+                return 1;
+            }
+            cerr << "Trace written to: " << opts.profilePath << "\n";
+        }
+    }
+    return status;
+}
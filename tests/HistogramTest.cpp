@@ -0,0 +1,142 @@
+#include "Test.h"
+#include "Histogram.h"
+#include "ImageProc.h"
+#include "MappedBmp.h"
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+
+using namespace std;
+
+static vector<vector<uint64_t>> naive_histograms(const CImg<unsigned char>& img) {
+    vector<vector<uint64_t>> hists(img.spectrum(), vector<uint64_t>(256, 0));
+    cimg_forXYC(img, x, y, c) ++hists[c][img(x, y, 0, c)];
+    return hists;
+}
+
+// Runs of equal values go through the sub-histograms too
+static CImg<unsigned char> histogram_test_image(int w, int h, int s) {
+    CImg<unsigned char> img = test_image(w, h, s);
+    cimg_forXYC(img, x, y, c) {
+        if ((y + c) % 3 == 0) img(x, y, 0, c) = (unsigned char)(c * 40);
+    }
+    return img;
+}
+
+TEST(histograms_count_every_pixel) {
+    const int sizes[][2] = { { 37, 29 }, { 1, 7 }, { 301, 203 } };
+    for (const auto& size : sizes) {
+        CImg<unsigned char> img = histogram_test_image(size[0], size[1], 3);
+        CHECK(compute_histograms(img) == naive_histograms(img));
+    }
+}
+
+TEST(library_histograms_match_cli) {
+    for (int s : { 1, 3, 4 }) {
+        for (int pad : { 0, 5 }) {
+            CImg<unsigned char> img = histogram_test_image(67, 45, s);
+            size_t stride = (size_t)img.width() * s + pad;
+            vector<unsigned char> buffer(stride * img.height(), 0xee);
+            cimg_forXYC(img, x, y, c) buffer[stride * y + (size_t)x * s + c] = img(x, y, 0, c);
+            imageproc::ImageView view = { buffer.data(), img.width(), img.height(), s, stride };
+
+            vector<uint64_t> flat(256 * (size_t)s);
+            imageproc::histograms(view, flat.data());
+            vector<vector<uint64_t>> cli = compute_histograms(img);
+            bool same = true;
+            for (int c = 0; c < s; ++c) {
+                same = same && equal(cli[c].begin(), cli[c].end(), flat.begin() + 256 * c);
+            }
+            ostringstream what;
+            what << "channels=" << s << " pad=" << pad;
+            if (!same) test_failed(__FILE__, __LINE__, what.str());
+            CHECK(cli == naive_histograms(img));
+        }
+    }
+}
+
+TEST(mapped_bmp_histograms_match_decoded) {
+    CImg<unsigned char> img = histogram_test_image(53, 31, 3);  // Rows padded to 4 bytes
+    string path = "histogramTest.bmp";
+    img.save_bmp(path.c_str());
+    MappedBmp bmp;
+    CHECK(bmp.open(path));
+    CHECK(bmp.histograms() == naive_histograms(img));
+    remove(path.c_str());
+}
+
+// Two passes straight from the definitions, in long double
+static ImageCharacteristics two_pass_characteristics(const vector<uint64_t>& hist) {
+    long double n = 0, mean = 0, mu2 = 0, mu3 = 0, mu4 = 0, c5 = 0, c6 = 0;
+    for (int m = 0; m < 256; ++m) {
+        n += hist[m];
+        mean += (long double)m * hist[m];
+    }
+    mean /= n;
+    for (int m = 0; m < 256; ++m) {
+        long double d = m - mean, p = hist[m] / n;
+        mu2 += d * d * p;
+        mu3 += d * d * d * p;
+        mu4 += d * d * d * d * p;
+        c5 += p * p;
+        if (hist[m] > 0) c6 -= p * log2l(p);
+    }
+    long double sd = sqrtl(mu2);
+    ImageCharacteristics ch;
+    ch.mean = (double)mean;
+    ch.variance = (double)mu2;
+    ch.stdev = (double)sd;
+    ch.varcoeff_I = (double)(sd / mean);
+    ch.asymmetry = (double)(mu3 / (sd * sd * sd));
+    ch.flattening = (double)(mu4 / (mu2 * mu2) - 3);
+    ch.varcoeff_II = (double)c5;
+    ch.entropy = (double)c6;
+    return ch;
+}
+
+static bool close_to(double a, double b) {
+    return fabs(a - b) <= 1e-9 * max(1.0, fabs(b));
+}
+
+TEST(characteristics_match_two_pass_definition) {
+    vector<vector<uint64_t>> cases;
+    // Near-constant channels, where power sums cancel: all 255 but one 254
+    for (uint64_t n : { 1000000ull, 100000000ull, 10000000000ull }) {
+        vector<uint64_t> h(256, 0);
+        h[255] = n - 1;
+        h[254] = 1;
+        cases.push_back(h);
+    }
+    vector<uint64_t> tail(256, 0), spread(256, 0), dark(256, 0);
+    for (int m = 0; m < 256; ++m) {
+        tail[m] = (uint64_t)(1e9 * exp(-m / 12.0));  // Long right tail
+        spread[m] = 1000 + (uint64_t)m * m * 37 % 4099;
+    }
+    dark[0] = 5000000;
+    dark[1] = 3;
+    dark[200] = 1;
+    cases.push_back(tail);
+    cases.push_back(spread);
+    cases.push_back(dark);
+
+    for (size_t i = 0; i < cases.size(); ++i) {
+        ImageCharacteristics got = characteristics_from_histogram(cases[i]);
+        ImageCharacteristics want = two_pass_characteristics(cases[i]);
+        ostringstream what;
+        what << "case " << i << ": asymmetry " << got.asymmetry << " vs " << want.asymmetry
+             << ", flattening " << got.flattening << " vs " << want.flattening;
+        bool same = close_to(got.mean, want.mean) && close_to(got.variance, want.variance) &&
+                    close_to(got.stdev, want.stdev) && close_to(got.varcoeff_I, want.varcoeff_I) &&
+                    close_to(got.asymmetry, want.asymmetry) &&
+                    close_to(got.flattening, want.flattening) &&
+                    close_to(got.varcoeff_II, want.varcoeff_II) &&
+                    close_to(got.entropy, want.entropy);
+        if (!same) test_failed(__FILE__, __LINE__, what.str());
+    }
+
+    // Constant channel: no spread, no skew
+    vector<uint64_t> flat(256, 0);
+    flat[17] = 12345;
+    ImageCharacteristics ch = characteristics_from_histogram(flat);
+    CHECK(ch.mean == 17 && ch.variance == 0 && ch.asymmetry == 0 && ch.flattening == 0);
+}
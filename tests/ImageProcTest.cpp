@@ -0,0 +1,148 @@
+#include "Test.h"
+#include "ImageProc.h"
+#include "Geometric.h"
+#include "NoiseFilters.h"
+#include "Operations.h"
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// A planar image in a caller-owned interleaved buffer with padded rows
+struct Interleaved {
+    int width, height, channels;
+    size_t stride;
+    vector<unsigned char> bytes;
+
+    Interleaved(int w, int h, int s) : width(w), height(h), channels(s),
+                                       stride((size_t)w * s + 3), bytes(stride * h, 0xee) {}
+
+    explicit Interleaved(const CImg<unsigned char>& img)
+        : Interleaved(img.width(), img.height(), img.spectrum()) {
+        cimg_forXYC(img, x, y, c) bytes[stride * y + (size_t)x * channels + c] = img(x, y, 0, c);
+    }
+
+    imageproc::MutableImageView view() {
+        imageproc::MutableImageView v = { bytes.data(), width, height, channels, stride };
+        return v;
+    }
+
+    CImg<unsigned char> planar() const {
+        CImg<unsigned char> img(width, height, 1, channels);
+        cimg_forXYC(img, x, y, c) img(x, y, 0, c) = bytes[stride * y + (size_t)x * channels + c];
+        return img;
+    }
+};
+
+// fn(src, dst) into a separate buffer of dst's size, and in place where
+// the size is kept
+template <typename Fn>
+static void check_library_op(const CImg<unsigned char>& src, const CImg<unsigned char>& expected,
+                             const char* what, Fn fn) {
+    Interleaved in(src), out(expected.width(), expected.height(), expected.spectrum());
+    fn(in.view(), out.view());
+    CHECK_SAME_IMAGE(out.planar(), expected, what);
+    if (expected.width() == src.width() && expected.height() == src.height()) {
+        fn(in.view(), in.view());
+        CHECK_SAME_IMAGE(in.planar(), expected, string(what) + " in place");
+    }
+}
+
+typedef imageproc::ImageView View;
+typedef imageproc::MutableImageView Dst;
+
+TEST(library_image_processor_ops_match_direct) {
+    CImg<unsigned char> src = test_image(37, 21, 3);
+    check_library_op(src, op_brightness(src, -40), "brightness",
+                     [](const View& s, const Dst& d) { imageproc::brightness(s, d, -40); });
+    check_library_op(src, op_contrast_linear(src, 1.7f), "contrast",
+                     [](const View& s, const Dst& d) { imageproc::contrast(s, d, 1.7f); });
+    check_library_op(src, op_negative(src), "negative",
+                     [](const View& s, const Dst& d) { imageproc::negative(s, d); });
+    check_library_op(src, op_rgb_add(src, 10, -300, 255), "rgb offset",
+                     [](const View& s, const Dst& d) { imageproc::rgb_offset(s, d, 10, -300, 255); });
+    check_library_op(src, op_hflip(src), "hflip",
+                     [](const View& s, const Dst& d) { imageproc::flip_horizontal(s, d); });
+    check_library_op(src, op_vflip(src), "vflip",
+                     [](const View& s, const Dst& d) { imageproc::flip_vertical(s, d); });
+    check_library_op(src, op_dflip(src), "transpose",
+                     [](const View& s, const Dst& d) { imageproc::transpose(s, d); });
+    check_library_op(src, op_shrink(src, 0.4f), "shrink",
+                     [](const View& s, const Dst& d) { imageproc::resize_nearest(s, d); });
+    check_library_op(src, op_enlarge(src, 2.5f), "enlarge",
+                     [](const View& s, const Dst& d) { imageproc::resize_nearest(s, d); });
+
+    Interleaved in(src), wrong(21, 21, 3);
+    bool threw = false;
+    try {
+        imageproc::transpose(in.view(), wrong.view());
+    } catch (const invalid_argument&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+TEST(library_smoothing_matches_direct) {
+    CImg<unsigned char> src = test_image(45, 29, 3);
+    CImg<unsigned char> box, boxMirror, blurred, blurredConstant;
+    box_filter(src, box, 3, 3);
+    box_filter(src, boxMirror, 1, 1, Border(BORDER_MIRROR));
+    gaussian_blur(src, blurred, 1.5f);
+    gaussian_blur(src, blurredConstant, 4.0f, Border(BORDER_CONSTANT, 90));
+    check_library_op(src, box, "mean",
+                     [](const View& s, const Dst& d) { imageproc::arithmetic_mean(s, d, 7); });
+    check_library_op(src, boxMirror, "mean mirror", [](const View& s, const Dst& d) {
+        imageproc::arithmetic_mean(s, d, 3, imageproc::BORDER_MIRROR);
+    });
+    check_library_op(src, blurred, "gaussian",
+                     [](const View& s, const Dst& d) { imageproc::gaussian_blur(s, d, 1.5f); });
+    check_library_op(src, blurredConstant, "gaussian constant", [](const View& s, const Dst& d) {
+        imageproc::gaussian_blur(s, d, 4.0f, imageproc::BORDER_CONSTANT, 90);
+    });
+
+    Interleaved in(src), out(45, 29, 3);
+    int rejected = 0;
+    for (auto op : { +[](const View& s, const Dst& d) { imageproc::arithmetic_mean(s, d, 4); },
+                     +[](const View& s, const Dst& d) { imageproc::gaussian_blur(s, d, 0.0f); } }) {
+        try {
+            op(in.view(), out.view());
+        } catch (const invalid_argument&) {
+            ++rejected;
+        }
+    }
+    CHECK(rejected == 2);
+}
+
+TEST(library_medians_match_direct) {
+    CImg<unsigned char> src = test_image(45, 29, 3);
+    cimg_for(src, p, unsigned char) *p = *p < 40 ? 0 : *p > 215 ? 255 : *p;  // Impulses
+    CImg<unsigned char> med, medWrap, adaptive, adaptiveCopy;
+    median_filter(src, med, 2);
+    median_filter(src, medWrap, 1, Border(BORDER_WRAP));
+    adaptive_median(src, adaptive, 3, 9);
+    adaptive_median(src, adaptiveCopy, 5, 7, Border(BORDER_COPY));
+    check_library_op(src, med, "median",
+                     [](const View& s, const Dst& d) { imageproc::median(s, d, 5); });
+    check_library_op(src, medWrap, "median wrap", [](const View& s, const Dst& d) {
+        imageproc::median(s, d, 3, imageproc::BORDER_WRAP);
+    });
+    check_library_op(src, adaptive, "adaptive median",
+                     [](const View& s, const Dst& d) { imageproc::adaptive_median(s, d, 3, 9); });
+    check_library_op(src, adaptiveCopy, "adaptive median copy", [](const View& s, const Dst& d) {
+        imageproc::adaptive_median(s, d, 5, 7, imageproc::BORDER_COPY);
+    });
+
+    Interleaved in(src), out(45, 29, 3);
+    int rejected = 0;
+    for (auto op : { +[](const View& s, const Dst& d) { imageproc::median(s, d, 257); },
+                     +[](const View& s, const Dst& d) { imageproc::adaptive_median(s, d, 5, 3); },
+                     +[](const View& s, const Dst& d) { imageproc::adaptive_median(s, d, 3, 8); } }) {
+        try {
+            op(in.view(), out.view());
+        } catch (const invalid_argument&) {
+            ++rejected;
+        }
+    }
+    CHECK(rejected == 3);
+}
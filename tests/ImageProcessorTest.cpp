@@ -0,0 +1,203 @@
+#include "Test.h"
+#include "ImageProcessor.h"
+#include "Geometric.h"
+#include "Histogram.h"
+#include "NoiseFilters.h"
+#include "LinearFilters.h"
+#include "NonLinearFilters.h"
+#include "Operations.h"
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <utility>
+
+using namespace std;
+
+static CImg<unsigned char> processed(const CImg<unsigned char>& src,
+                                     void (*op)(ImageProcessor&)) {
+    QuietCout quiet;
+    ImageProcessor proc;
+    proc.setImage(src);
+    op(proc);
+    return proc.getImage();
+}
+
+TEST(image_processor_load_save_round_trip) {
+    QuietCout quiet;
+    CImg<unsigned char> src = test_image(33, 17, 3);
+    string path = "imageProcessorTest.bmp";
+    ImageProcessor proc;
+    proc.setImage(src);
+    CHECK(proc.saveImage(path));
+    ImageProcessor loaded;
+    CHECK(loaded.loadImage(path));
+    CHECK(loaded.getWidth() == 33 && loaded.getHeight() == 17 && loaded.getChannels() == 3);
+    CHECK_SAME_IMAGE(loaded.getImage(), src, "reloaded");
+    remove(path.c_str());
+}
+
+TEST(image_processor_point_ops_match_direct) {
+    CImg<unsigned char> src = test_image(40, 23, 3);
+    CHECK_SAME_IMAGE(processed(src, [](ImageProcessor& p) { p.applyBrightness(-40); }),
+                     op_brightness(src, -40), "brightness");
+    CHECK_SAME_IMAGE(processed(src, [](ImageProcessor& p) { p.applyNegative(); }),
+                     op_negative(src), "negative");
+    CHECK_SAME_IMAGE(processed(src, [](ImageProcessor& p) { p.applyRGBOffset(10, -300, 255); }),
+                     op_rgb_add(src, 10, -300, 255), "rgb offset");
+    CHECK_SAME_IMAGE(processed(src, [](ImageProcessor& p) { p.applyContrast(1.5f); }),
+                     op_contrast_linear(src, 1.5f), "contrast");
+    CHECK_SAME_IMAGE(processed(src, [](ImageProcessor& p) { p.applyHistogramPower(10, 200); }),
+                     histogram_power23(src, 10, 200), "hpower");
+}
+
+TEST(image_processor_scratch_ops_match_direct) {
+    CImg<unsigned char> src = test_image(40, 23, 3);
+    // Chained ops reuse the scratch buffer: each must see the previous result
+    CHECK_SAME_IMAGE(processed(src, [](ImageProcessor& p) {
+                         p.applyEdgeSharpen(1);
+                         p.applyRosenfeld(2);
+                         p.applyEdgeSharpen(0);
+                     }),
+                     edge_sharpen_optimized(rosenfeld_operator(edge_sharpen_type1(src), 2)),
+                     "sedgesharp, orosenfeld, sedgesharp");
+}
+
+TEST(image_processor_geometry) {
+    CImg<unsigned char> src = test_image(40, 23, 3);
+    CHECK_SAME_IMAGE(processed(src, [](ImageProcessor& p) { p.applyHorizontalFlip(); }),
+                     src.get_mirror('x'), "hflip");
+    CHECK_SAME_IMAGE(processed(src, [](ImageProcessor& p) { p.applyVerticalFlip(); }),
+                     src.get_mirror('y'), "vflip");
+    CHECK_SAME_IMAGE(processed(src, [](ImageProcessor& p) { p.applyDiagonalFlip(); }),
+                     src.get_permute_axes("yxzc"), "dflip");
+    CHECK_SAME_IMAGE(op_vflip(test_image(5, 7, 2)), test_image(5, 7, 2).get_mirror('y'),
+                     "vflip, odd height");
+    CHECK(processed(src, [](ImageProcessor& p) { p.applyShrink(0.5f); }).width() == 20);
+    CHECK(processed(src, [](ImageProcessor& p) { p.applyEnlarge(2.0f); }).height() == 46);
+}
+
+// After warm-up, ops reuse the image and scratch buffers
+TEST(image_processor_reuses_buffers) {
+    QuietCout quiet;
+    ImageProcessor proc;
+    proc.setImage(test_image(40, 23, 3));
+    const unsigned char* buffer = proc.getImage().data();
+    proc.applyContrast(1.5f);
+    proc.applyHorizontalFlip();
+    proc.applyVerticalFlip();
+    CHECK(proc.getImage().data() == buffer);  // In place
+
+    proc.applyDiagonalFlip();  // Allocates the scratch buffer once
+    proc.applyDiagonalFlip();
+    CHECK(proc.getImage().data() == buffer);
+    proc.applyEdgeSharpen(1);
+    proc.applyRosenfeld(2);
+    proc.applyArithmeticMean(5);
+    proc.applyGaussianBlur(2.0f);
+    proc.applyMedian(3);
+    proc.applyAdaptiveMedian(3, 5);
+    CHECK(proc.getImage().data() == buffer);
+}
+
+TEST(image_processor_moves_images_without_copying) {
+    QuietCout quiet;
+    CImg<unsigned char> src = test_image(40, 23, 3);
+    CImg<unsigned char> moved = src;
+    const unsigned char* buffer = moved.data();
+    ImageProcessor proc;
+    proc.setImage(move(moved));
+    CHECK(moved.is_empty());
+    CHECK(proc.isLoaded() && proc.getImage().data() == buffer);
+
+    proc.applyNegative();  // In place: the buffer stays
+    CImg<unsigned char> out = proc.takeImage();
+    CHECK(out.data() == buffer);
+    CHECK_SAME_IMAGE(out, op_negative(src), "taken image");
+    CHECK(!proc.isLoaded());
+
+    bool threw = false;
+    try {
+        proc.takeImage();
+    } catch (const runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+TEST(image_processor_records_timings) {
+    QuietCout quiet;
+    CImg<unsigned char> src = test_image(40, 23, 3);
+    string path = "imageProcessorTimings.bmp";
+    src.save_bmp(path.c_str());
+
+    ImageProcessor proc;
+    CHECK(proc.loadImage(path));
+    proc.applyNegative();
+    proc.applyEdgeSharpen(0);
+    CHECK(proc.saveImage(path));
+    remove(path.c_str());
+
+    const vector<ProfileRecord>& t = proc.getTimings();
+    CHECK(t.size() == 4);
+    if (t.size() == 4) {
+        CHECK(t[0].stage == "decode" && t[1].stage == "negative" &&
+              t[2].stage == "sedgesharp" && t[3].stage == "encode");
+        CHECK(t[0].bytesWritten == src.size() && t[3].bytesRead == src.size());
+        for (const ProfileRecord& r : t) {
+            CHECK(r.pixels == 40 * 23 && r.wallMs >= 0);
+        }
+    }
+    proc.resetTimings();
+    CHECK(proc.getTimings().empty());
+    proc.applyNegative();
+    CHECK(proc.getTimings().size() == 1);
+}
+
+TEST(image_processor_smoothing_matches_direct) {
+    CImg<unsigned char> src = test_image(61, 37, 3);
+    CImg<unsigned char> box, blurred;
+    box_filter(src, box, 2, 2);
+    gaussian_blur(src, blurred, 2.5f);
+    CHECK_SAME_IMAGE(processed(src, [](ImageProcessor& p) { p.applyArithmeticMean(5); }),
+                     box, "amean");
+    CHECK_SAME_IMAGE(processed(src, [](ImageProcessor& p) { p.applyGaussianBlur(2.5f); }),
+                     blurred, "gaussian");
+
+    QuietCout quiet;
+    ImageProcessor proc;
+    proc.setImage(src);
+    bool threw = false;
+    try {
+        proc.applyArithmeticMean(4);
+    } catch (const runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+TEST(image_processor_medians_match_direct) {
+    CImg<unsigned char> src = test_image(61, 37, 3);
+    cimg_for(src, p, unsigned char) *p = *p < 40 ? 0 : *p > 215 ? 255 : *p;  // Impulses
+    CImg<unsigned char> median, adaptive;
+    median_filter(src, median, 2);
+    adaptive_median(src, adaptive, 3, 9);
+    CHECK_SAME_IMAGE(processed(src, [](ImageProcessor& p) { p.applyMedian(5); }),
+                     median, "median");
+    CHECK_SAME_IMAGE(processed(src, [](ImageProcessor& p) { p.applyAdaptiveMedian(3, 9); }),
+                     adaptive, "adaptive median");
+
+    QuietCout quiet;
+    ImageProcessor proc;
+    proc.setImage(src);
+    int rejected = 0;
+    for (auto op : { +[](ImageProcessor& p) { p.applyMedian(2); },
+                     +[](ImageProcessor& p) { p.applyAdaptiveMedian(5, 3); },
+                     +[](ImageProcessor& p) { p.applyAdaptiveMedian(3, 8); } }) {
+        try {
+            op(proc);
+        } catch (const runtime_error&) {
+            ++rejected;
+        }
+    }
+    CHECK(rejected == 3);
+}
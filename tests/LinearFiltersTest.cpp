@@ -0,0 +1,149 @@
+#include "Test.h"
+#include "LinearFilters.h"
+#include <sstream>
+
+using namespace std;
+
+typedef vector<vector<float>> Mask;
+
+// Exact result of a mask taps / 2^shift: integer sum, rounded half up
+static CImg<unsigned char> fixed_point_reference(const CImg<unsigned char>& src,
+                                                 const vector<vector<int>>& taps, int shift,
+                                                 const Border& border) {
+    int w = src.width(), h = src.height(), M = taps.size() / 2;
+    CImg<unsigned char> out(w, h, 1, src.spectrum());
+    cimg_forXYC(out, x, y, c) {
+        const unsigned char* plane = src.data(0, 0, 0, c);
+        long long sum = 0;
+        for (int i = -M; i <= M; ++i) {
+            for (int j = -M; j <= M; ++j) {
+                sum += taps[i + M][j + M] * border_fetch(plane, w, h, x + j, y + i, border);
+            }
+        }
+        long long v = (sum + ((1LL << shift) >> 1)) >> shift;
+        out(x, y, 0, c) = (unsigned char)max(0LL, min(255LL, v));
+    }
+    return out;
+}
+
+static Mask scaled(const vector<vector<int>>& taps, int shift) {
+    Mask mask(taps.size(), vector<float>(taps.size()));
+    for (size_t i = 0; i < taps.size(); ++i) {
+        for (size_t j = 0; j < taps.size(); ++j) mask[i][j] = ldexp((float)taps[i][j], -shift);
+    }
+    return mask;
+}
+
+TEST(convolve_fft_exact_for_dyadic_masks) {
+    // 9x9 binomial (separable, / 2^16), and a non-separable mask in
+    // 1/128 steps whose sums often land exactly on .5
+    const int binomial[9] = { 1, 8, 28, 56, 70, 56, 28, 8, 1 };
+    vector<vector<int>> gauss(9, vector<int>(9)), ring(9, vector<int>(9));
+    for (int i = 0; i < 9; ++i) {
+        for (int j = 0; j < 9; ++j) {
+            gauss[i][j] = binomial[i] * binomial[j];
+            ring[i][j] = (i + j) % 3 == 0 ? 3 : 1;
+        }
+    }
+    ring[4][4] = -20;
+    struct Case { const vector<vector<int>>* taps; int shift; };
+    const Case cases[] = { { &gauss, 16 }, { &ring, 7 } };
+    const BorderMode modes[] = { BORDER_CLAMP, BORDER_MIRROR, BORDER_CONSTANT };
+    const int sizes[][2] = { { 40, 40 }, { 131, 97 } };
+
+    for (const Case& k : cases) {
+        Mask mask = scaled(*k.taps, k.shift);
+        for (const auto& size : sizes) {
+            CImg<unsigned char> src = test_image(size[0], size[1], 2);
+            for (BorderMode mode : modes) {
+                Border border(mode, 200);
+                ostringstream what;
+                what << "shift=" << k.shift << " " << size[0] << "x" << size[1] << " "
+                     << border_mode_name(mode);
+                CImg<unsigned char> expected = fixed_point_reference(src, *k.taps, k.shift, border);
+                CImg<unsigned char> fft;
+                convolve_fft(src, fft, mask, border);
+                CHECK_SAME_IMAGE(fft, expected, "fft " + what.str());
+                CHECK_SAME_IMAGE(convolve_universal(src, mask, border), expected,
+                                 "universal " + what.str());
+            }
+        }
+    }
+}
+
+// The float definition: taps summed in (i, j) order, rounded; the frame
+// keeps the source in copy mode
+static CImg<unsigned char> float_reference(const CImg<unsigned char>& src, const Mask& mask,
+                                           const Border& border) {
+    int w = src.width(), h = src.height(), M = mask.size() / 2;
+    CImg<unsigned char> out(w, h, 1, src.spectrum());
+    cimg_forXYC(out, x, y, c) {
+        if (border.mode == BORDER_COPY && (x < M || y < M || x >= w - M || y >= h - M)) {
+            out(x, y, 0, c) = src(x, y, 0, c);
+            continue;
+        }
+        const unsigned char* plane = src.data(0, 0, 0, c);
+        float sum = 0.0f;
+        for (int i = -M; i <= M; ++i) {
+            for (int j = -M; j <= M; ++j) {
+                sum += mask[i + M][j + M] * border_fetch(plane, w, h, x + j, y + i, border);
+            }
+        }
+        out(x, y, 0, c) = (unsigned char)clampv((int)round(sum), 0, 255);
+    }
+    return out;
+}
+
+TEST(convolve_fixed_point_paths_match_float) {
+    // Each mask is exact in fixed point, so every path must give the float
+    // definition's bytes. With SIMD, masks within 16 bits run through the
+    // int16 rows; at SIMD_SCALAR the separable ones through the int32 1D
+    // passes. The 7x7 binomial (/ 2^12) needs the int32 passes everywhere.
+    vector<vector<int>> sharpen = { { 0, -1, 0 }, { -1, 5, -1 }, { 0, -1, 0 } };
+    vector<vector<int>> binomial5(5, vector<int>(5)), binomial7(7, vector<int>(7)),
+                        skew5(5, vector<int>(5));
+    const int b5[5] = { 1, 4, 6, 4, 1 }, b7[7] = { 1, 6, 15, 20, 15, 6, 1 };
+    for (int i = 0; i < 7; ++i) {
+        for (int j = 0; j < 7; ++j) {
+            binomial7[i][j] = b7[i] * b7[j];
+            if (i < 5 && j < 5) {
+                binomial5[i][j] = b5[i] * b5[j];
+                skew5[i][j] = (i * 5 + j * 3) % 7 - 2;
+            }
+        }
+    }
+    skew5[2][2] = 40;
+    struct Case { const vector<vector<int>>* taps; int shift; };
+    const Case cases[] = { { &sharpen, 0 }, { &binomial5, 8 }, { &binomial7, 12 }, { &skew5, 5 } };
+    const BorderMode modes[] = { BORDER_CLAMP, BORDER_MIRROR, BORDER_WRAP, BORDER_CONSTANT,
+                                 BORDER_COPY };
+    const int sizes[][2] = { { 45, 31 }, { 8, 50 }, { 7, 7 } };
+    SimdLevel detected = simd_detect();
+
+    for (const Case& k : cases) {
+        Mask mask = scaled(*k.taps, k.shift);
+        vector<int> taps;
+        int shift;
+        CHECK(kernel_fixed_point(mask, taps, shift));
+        for (const auto& size : sizes) {
+            CImg<unsigned char> src = test_image(size[0], size[1], 2, size[0]);
+            for (BorderMode mode : modes) {
+                Border border(mode, 200);
+                CImg<unsigned char> expected = float_reference(src, mask, border);
+                if (mode != BORDER_COPY) {
+                    CHECK_SAME_IMAGE(fixed_point_reference(src, *k.taps, k.shift, border),
+                                     expected, "integer vs float definition");
+                }
+                for (int level = SIMD_SCALAR; level <= detected; ++level) {
+                    simd_set_level((SimdLevel)level);
+                    ostringstream what;
+                    what << k.taps->size() << "x" << k.taps->size() << " shift=" << k.shift
+                         << " " << size[0] << "x" << size[1] << " " << border_mode_name(mode)
+                         << " " << simd_level_name((SimdLevel)level);
+                    CHECK_SAME_IMAGE(convolve_universal(src, mask, border), expected, what.str());
+                }
+                simd_set_level(detected);
+            }
+        }
+    }
+}
@@ -0,0 +1,107 @@
+#include "Test.h"
+#include "NoiseFilters.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+// Band heights follow the thread count and sigma; results must not
+TEST(gaussian_blur_independent_of_bands) {
+    CImg<unsigned char> src = test_image(301, 203, 3);
+    int threads = thread_count();
+    for (float sigma : { 0.8f, 4.0f, 20.0f, 150.0f }) {
+        for (BorderMode mode : { BORDER_CLAMP, BORDER_CONSTANT, BORDER_COPY }) {
+            Border border(mode, 30);
+            CImg<unsigned char> one, many;
+            set_thread_count(1);
+            gaussian_blur(src, one, sigma, border);
+            set_thread_count(16);
+            gaussian_blur(src, many, sigma, border);
+            ostringstream what;
+            what << "sigma=" << sigma << " " << border_mode_name(mode);
+            CHECK_SAME_IMAGE(many, one, what.str());
+        }
+    }
+    set_thread_count(threads);
+}
+
+// Sorted (2r + 1)^2 window around (x, y); the outside value is clamped
+// like the filters do
+static vector<int> sorted_window(const CImg<unsigned char>& src, int c, int x, int y, int r,
+                                 Border border) {
+    border.value = clampv(border.value, 0, 255);
+    vector<int> v;
+    for (int j = -r; j <= r; ++j) {
+        for (int i = -r; i <= r; ++i) {
+            v.push_back(border_fetch(src.data(0, 0, 0, c), src.width(), src.height(),
+                                     x + i, y + j, border));
+        }
+    }
+    sort(v.begin(), v.end());
+    return v;
+}
+
+static bool in_copy_frame(const CImg<unsigned char>& src, int x, int y, int r,
+                          const Border& border) {
+    return border.mode == BORDER_COPY &&
+           (x < r || y < r || x >= src.width() - r || y >= src.height() - r);
+}
+
+// Salt and pepper over a narrow band of grays
+static CImg<unsigned char> impulse_image(int w, int h, int s) {
+    CImg<unsigned char> img = test_image(w, h, s, 7);
+    cimg_for(img, p, unsigned char) {
+        *p = *p < 60 ? 0 : *p > 200 ? 255 : 100 + *p % 20;
+    }
+    return img;
+}
+
+TEST(median_filters_match_sorting) {
+    const BorderMode modes[] = { BORDER_CLAMP, BORDER_MIRROR, BORDER_WRAP,
+                                 BORDER_CONSTANT, BORDER_COPY };
+    const int sizes[][2] = { { 1, 1 }, { 9, 7 }, { 41, 23 } };
+    for (const auto& size : sizes) {
+        CImg<unsigned char> src = impulse_image(size[0], size[1], 2);
+        for (BorderMode mode : modes) {
+            Border border(mode, -5);
+            for (int r : { 0, 1, 2, 5 }) {
+                CImg<unsigned char> out, expected(src);
+                median_filter(src, out, r, border);
+                cimg_forXYC(src, x, y, c) {
+                    if (in_copy_frame(src, x, y, r, border)) continue;
+                    vector<int> v = sorted_window(src, c, x, y, r, border);
+                    expected(x, y, 0, c) = (unsigned char)v[v.size() / 2];
+                }
+                ostringstream what;
+                what << "median " << size[0] << "x" << size[1] << " "
+                     << border_mode_name(mode) << " r=" << r;
+                CHECK_SAME_IMAGE(out, expected, what.str());
+            }
+            for (int k : { 3, 5 }) {
+                for (int smax : { k, k + 2, k + 6 }) {
+                    CImg<unsigned char> out, expected(src);
+                    adaptive_median(src, out, k, smax, border);
+                    cimg_forXYC(src, x, y, c) {
+                        if (in_copy_frame(src, x, y, k / 2, border)) continue;
+                        // Grow while the median is an impulse, up to smax
+                        vector<int> v;
+                        for (int r = k / 2; r <= smax / 2; ++r) {
+                            v = sorted_window(src, c, x, y, r, border);
+                            if (v.front() < v[v.size() / 2] && v[v.size() / 2] < v.back()) break;
+                        }
+                        int z = src(x, y, 0, c), zmed = v[v.size() / 2];
+                        bool keep = v.front() < zmed && zmed < v.back() &&
+                                    v.front() < z && z < v.back();
+                        expected(x, y, 0, c) = (unsigned char)(keep ? z : zmed);
+                    }
+                    ostringstream what;
+                    what << "adaptive " << size[0] << "x" << size[1] << " "
+                         << border_mode_name(mode) << " k=" << k << " smax=" << smax;
+                    CHECK_SAME_IMAGE(out, expected, what.str());
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#include "Test.h"
+#include "NonLinearFilters.h"
+#include <cstdlib>
+#include <sstream>
+
+using namespace std;
+
+// Straight from the definition: |P pixels from (x, y) on - P pixels before| / P
+static int rosenfeld_at(const unsigned char* plane, int w, int h, int x, int y,
+                        int dx, int dy, int P, const Border& border) {
+    int pos = 0, neg = 0;
+    for (int k = 0; k < P; ++k) pos += border_fetch(plane, w, h, x + k * dx, y + k * dy, border);
+    for (int k = 1; k <= P; ++k) neg += border_fetch(plane, w, h, x - k * dx, y - k * dy, border);
+    return clampv(abs(pos - neg) / P, 0, 255);
+}
+
+static CImg<unsigned char> rosenfeld_reference(const CImg<unsigned char>& src, int P,
+                                               const Border& border,
+                                               RosenfeldDirection direction) {
+    int w = src.width(), h = src.height();
+    bool horizontal = direction != ROSENFELD_VERTICAL;
+    bool vertical = direction != ROSENFELD_HORIZONTAL;
+    CImg<unsigned char> out(w, h, 1, src.spectrum());
+    cimg_forXYC(out, x, y, c) {
+        const unsigned char* plane = src.data(0, 0, 0, c);
+        bool frame = (horizontal && (x < P || x >= w - P)) || (vertical && (y < P || y >= h - P));
+        int v = 0;
+        if (border.mode == BORDER_COPY && frame) {
+            v = src(x, y, 0, c);
+        } else {
+            if (horizontal) v = rosenfeld_at(plane, w, h, x, y, 1, 0, P, border);
+            if (vertical) v = max(v, rosenfeld_at(plane, w, h, x, y, 0, 1, P, border));
+        }
+        out(x, y, 0, c) = (unsigned char)v;
+    }
+    return out;
+}
+
+TEST(rosenfeld_matches_definition) {
+    const BorderMode modes[] = { BORDER_CLAMP, BORDER_MIRROR, BORDER_WRAP,
+                                 BORDER_CONSTANT, BORDER_COPY };
+    const RosenfeldDirection directions[] = { ROSENFELD_HORIZONTAL, ROSENFELD_VERTICAL,
+                                              ROSENFELD_BOTH };
+    const int sizes[][2] = { { 37, 29 }, { 5, 9 }, { 64, 3 } };
+    for (const auto& size : sizes) {
+        CImg<unsigned char> src = test_image(size[0], size[1], 2);
+        for (BorderMode mode : modes) {
+            Border border(mode, 77);
+            for (RosenfeldDirection direction : directions) {
+                for (int P : { 1, 2, 3, 7 }) {
+                    ostringstream what;
+                    what << size[0] << "x" << size[1] << " " << border_mode_name(mode)
+                         << " direction=" << direction << " P=" << P;
+                    CHECK_SAME_IMAGE(rosenfeld_operator(src, P, border, direction),
+                                     rosenfeld_reference(src, P, border, direction), what.str());
+                }
+            }
+        }
+    }
+}
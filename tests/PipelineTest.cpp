@@ -0,0 +1,40 @@
+#include "Test.h"
+#include "Pipeline.h"
+#include <sstream>
+
+using namespace std;
+
+TEST(fused_pipeline_matches_unfused) {
+    const char* specs[] = {
+        "sedgesharp:variant=1,orosenfeld:P=3",
+        "sedgesharp:optimized,orosenfeld:P=2:direction=both,sedgesharp:variant=3",
+        "orosenfeld:P=5:direction=vertical,sedgesharp:variant=2,orosenfeld:P=1",
+    };
+    // Wider than one 512-column tile and taller than one row of tiles
+    const int sizes[][2] = { { 700, 150 }, { 37, 5 } };
+    for (const auto& size : sizes) {
+        CImg<unsigned char> img = test_image(size[0], size[1], 3);
+        for (int mode = -1; mode <= BORDER_COPY; ++mode) {
+            if (mode == BORDER_WRAP) continue;  // Not tile-fused
+            CommandOptions base;
+            if (mode >= 0) {
+                base.border = Border((BorderMode)mode, 77);
+                base.borderSet = true;
+            }
+            for (const char* spec : specs) {
+                ostringstream what;
+                what << spec << " " << size[0] << "x" << size[1] << " "
+                     << (mode >= 0 ? border_mode_name((BorderMode)mode) : "default");
+                CImg<unsigned char> fused, unfused;
+                CommandOptions opts = base;
+                opts.command = string("--pipeline=") + spec;
+                ostringstream report, log;
+                opts.fuse = true;
+                run_pipeline(opts, img, "", "", fused, report, log);
+                opts.fuse = false;
+                run_pipeline(opts, img, "", "", unfused, report, log);
+                CHECK_SAME_IMAGE(fused, unfused, what.str());
+            }
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#include "Test.h"
+#include "SimdKernels.h"
+#include <cstdlib>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+// Straight from the definition in SimdKernels.h
+static unsigned char conv3x3_at(const unsigned char* const rows[3], int x, const short k[9]) {
+    int sum = 0;
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) sum += k[3 * i + j] * rows[i][x + j - 1];
+    }
+    return (unsigned char)clampv(sum, 0, 255);
+}
+
+TEST(conv3x3_row_same_at_every_simd_level) {
+    // The edge sharpening masks, and one with the largest int16-safe sum
+    const short masks[][9] = { { 0, -1, 0, -1, 5, -1, 0, -1, 0 },
+                               { -1, -1, -1, -1, 9, -1, -1, -1, -1 },
+                               { 1, -2, 1, -2, 5, -2, 1, -2, 1 },
+                               { -16, 16, -16, 16, 0, 16, -16, 16, -16 } };
+    SimdLevel detected = simd_detect();
+    // Widths around every vector size, so each level runs its tail too
+    const int widths[] = { 1, 2, 7, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 129, 257 };
+    for (int w : widths) {
+        CImg<unsigned char> img = test_image(w + 2, 3, 1, w);
+        const unsigned char* rows[3] = { img.data(1, 0), img.data(1, 1), img.data(1, 2) };
+        for (const short* k : masks) {
+            vector<unsigned char> expected(w);
+            for (int x = 0; x < w; ++x) expected[x] = conv3x3_at(rows, x, k);
+            for (int level = SIMD_SCALAR; level <= detected; ++level) {
+                simd_set_level((SimdLevel)level);
+                vector<unsigned char> out(w);
+                conv3x3_row_u8(rows[0], rows[1], rows[2], out.data(), w, k);
+                ostringstream what;
+                what << simd_level_name((SimdLevel)level) << " width=" << w << " k[4]=" << k[4];
+                if (out != expected) test_failed(__FILE__, __LINE__, what.str());
+            }
+        }
+    }
+    simd_set_level(detected);
+}
+
+// (exact sum + half) >> shift, clamped
+static unsigned char convmxm_at(const vector<const unsigned char*>& rows, int x,
+                                const vector<short>& k, int m, int shift) {
+    int sum = 0;
+    for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < m; ++j) sum += k[m * i + j] * rows[i][x + j];
+    }
+    return (unsigned char)clampv((sum + ((1 << shift) >> 1)) >> shift, 0, 255);
+}
+
+TEST(convmxm_row_same_at_every_simd_level) {
+    struct Mask { int m, shift; vector<short> k; };
+    vector<Mask> masks;
+    for (int m : { 3, 5, 7, 9 }) {
+        // Signed taps within the int16 bound, and non-negative ones
+        // using the unsigned range (255 * sum + half <= 65535)
+        Mask signedMask = { m, 6, vector<short>(m * m) }, unsignedMask = { m, 8, vector<short>(m * m) };
+        int total = 0;
+        for (int t = 0; t < m * m; ++t) {
+            signedMask.k[t] = (short)((t * 7) % 5 - 2);
+            total += abs(signedMask.k[t]);
+        }
+        signedMask.k[m * m / 2] = (short)(128 - total + abs(signedMask.k[m * m / 2]));
+        for (int t = 0; t < m * m; ++t) unsignedMask.k[t] = (short)(256 / (m * m) - t % 2);
+        masks.push_back(signedMask);
+        masks.push_back(unsignedMask);
+    }
+    SimdLevel detected = simd_detect();
+    const int widths[] = { 1, 5, 15, 16, 17, 31, 33, 63, 64, 65, 127, 129, 200 };
+    for (const Mask& mask : masks) {
+        for (int w : widths) {
+            CImg<unsigned char> img = test_image(w + mask.m - 1, mask.m, 1, w + mask.m);
+            vector<const unsigned char*> rows(mask.m);
+            for (int i = 0; i < mask.m; ++i) rows[i] = img.data(0, i);
+            vector<unsigned char> expected(w);
+            for (int x = 0; x < w; ++x) expected[x] = convmxm_at(rows, x, mask.k, mask.m, mask.shift);
+            for (int level = SIMD_SCALAR; level <= detected; ++level) {
+                simd_set_level((SimdLevel)level);
+                vector<unsigned char> out(w);
+                convmxm_row_u8(rows.data(), out.data(), w, mask.k.data(), mask.m, mask.shift);
+                ostringstream what;
+                what << simd_level_name((SimdLevel)level) << " " << mask.m << "x" << mask.m
+                     << " shift=" << mask.shift << " width=" << w;
+                if (out != expected) test_failed(__FILE__, __LINE__, what.str());
+            }
+        }
+    }
+    simd_set_level(detected);
+}
@@ -0,0 +1,55 @@
+#include "Test.h"
+#include "Commands.h"
+#include "Stream.h"
+#include <cstdio>
+#include <sstream>
+
+using namespace std;
+
+// Strip-wise output must be byte-identical to the whole-image command
+TEST(stream_matches_whole_image) {
+    const char* commands[][2] = {
+        { "--sedgesharp", "-variant=1" },
+        { "--sedgesharp", "-variant=3" },
+        { "--sedgesharp", "-optimized" },
+        { "--orosenfeld", "-P=4" },
+        { "--orosenfeld", "-direction=both" },
+        { "--hpower", "-gmin=10" },
+        { "--pipeline=sedgesharp:variant=2,orosenfeld:P=3:direction=vertical", "-P=1" },
+    };
+    string input = "streamTestIn.bmp", output = "streamTestOut.bmp";
+    test_image(53, 41, 3).save_bmp(input.c_str());  // Rows padded to 4 bytes
+    CImg<unsigned char> img(input.c_str());
+
+    QuietCout quiet;
+    for (int mode = -1; mode <= BORDER_COPY; ++mode) {
+        if (mode == BORDER_WRAP) continue;  // Needs the opposite edge
+        for (const auto& command : commands) {
+            CommandOptions opts;
+            opts.command = command[0];
+            string error;
+            CHECK(parse_option(command[1], opts, error));
+            if (mode >= 0) {
+                opts.border = Border((BorderMode)mode, 77);
+                opts.borderSet = true;
+            }
+            CImg<unsigned char> whole;
+            ostringstream report, log;
+            run_command(opts, img, input, "", whole, report, log);
+
+            opts.inputPath = input;
+            opts.outputPath = output;
+            for (int rows : { 1, 7, 41, 0 }) {  // 0: from the memory budget
+                opts.stripRows = rows;
+                CHECK(run_stream(opts) == 0);
+                ostringstream what;
+                what << command[0] << " " << command[1] << " "
+                     << (mode >= 0 ? border_mode_name((BorderMode)mode) : "default")
+                     << " strips of " << rows;
+                CHECK_SAME_IMAGE(CImg<unsigned char>(output.c_str()), whole, what.str());
+            }
+        }
+    }
+    remove(input.c_str());
+    remove(output.c_str());
+}
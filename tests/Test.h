@@ -0,0 +1,50 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include "Utils.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// Minimal test runner. TEST(name) { ... } registers a case that
+// TestMain.cpp runs; a failed CHECK reports its line and the case goes on.
+
+void register_test(const char* name, void (*fn)());
+void test_failed(const char* file, int line, const std::string& what);
+
+struct TestRegistrar {
+    TestRegistrar(const char* name, void (*fn)()) { register_test(name, fn); }
+};
+
+#define TEST(name)                                                   \
+    static void test_##name();                                       \
+    static TestRegistrar registrar_##name(#name, test_##name);       \
+    static void test_##name()
+
+#define CHECK(cond)                                                  \
+    do {                                                             \
+        if (!(cond)) test_failed(__FILE__, __LINE__, #cond);         \
+    } while (0)
+
+// Fails with the first differing pixel, and what describes the case
+#define CHECK_SAME_IMAGE(a, b, what)                                 \
+    do {                                                             \
+        std::string diff_ = image_difference(a, b);                  \
+        if (!diff_.empty()) test_failed(__FILE__, __LINE__, std::string(what) + ": " + diff_); \
+    } while (0)
+
+// Redirects cout while in scope: commands log every step there
+struct QuietCout {
+    std::ostringstream sink;
+    std::streambuf* old;
+    QuietCout() : old(std::cout.rdbuf(sink.rdbuf())) {}
+    ~QuietCout() { std::cout.rdbuf(old); }
+};
+
+// Deterministic noise image, the same on every machine
+CImg<unsigned char> test_image(int w, int h, int s, unsigned seed = 1);
+
+// "" when a and b are equal, else the sizes or the first differing pixel
+std::string image_difference(const CImg<unsigned char>& a, const CImg<unsigned char>& b);
+
+#endif
@@ -0,0 +1,68 @@
+#include "Test.h"
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+static vector<pair<const char*, void (*)()>>& registry() {
+    static vector<pair<const char*, void (*)()>> tests;
+    return tests;
+}
+
+static int failures = 0;
+
+void register_test(const char* name, void (*fn)()) {
+    registry().push_back(make_pair(name, fn));
+}
+
+void test_failed(const char* file, int line, const string& what) {
+    cerr << "  " << file << ":" << line << ": " << what << "\n";
+    ++failures;
+}
+
+CImg<unsigned char> test_image(int w, int h, int s, unsigned seed) {
+    CImg<unsigned char> img(w, h, 1, s);
+    unsigned state = seed * 2654435761u + 1;
+    cimg_for(img, p, unsigned char) {
+        state = state * 1664525u + 1013904223u;
+        *p = (unsigned char)(state >> 24);
+    }
+    return img;
+}
+
+string image_difference(const CImg<unsigned char>& a, const CImg<unsigned char>& b) {
+    ostringstream out;
+    if (a.width() != b.width() || a.height() != b.height() || a.spectrum() != b.spectrum()) {
+        out << "size " << a.width() << "x" << a.height() << "x" << a.spectrum() << " vs "
+            << b.width() << "x" << b.height() << "x" << b.spectrum();
+        return out.str();
+    }
+    cimg_forXYC(a, x, y, c) {
+        if (a(x, y, 0, c) != b(x, y, 0, c)) {
+            out << "(" << x << ", " << y << ", " << c << "): " << (int)a(x, y, 0, c)
+                << " vs " << (int)b(x, y, 0, c);
+            return out.str();
+        }
+    }
+    return "";
+}
+
+int main() {
+    int failed = 0;
+    for (const auto& test : registry()) {
+        int before = failures;
+        try {
+            test.second();
+        } catch (const exception& e) {
+            test_failed(test.first, 0, string("exception: ") + e.what());
+        }
+        bool ok = failures == before;
+        if (!ok) ++failed;
+        cout << (ok ? "PASS " : "FAIL ") << test.first << endl;
+    }
+    cout << registry().size() - failed << "/" << registry().size() << " tests passed" << endl;
+    return failed == 0 ? 0 : 1;
+}